@@ -0,0 +1,1131 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+#include <future>
+#include <thread>
+#include <utility>
+#include <fmt/format.h>
+
+#include "particleStore.hpp"
+#include "broadphase.hpp"
+#include "simulation.hpp"
+#include "simulationRenderer.hpp"
+#include "allocationStats.hpp"
+#include "narrowphase.hpp"
+#include "taskScheduler.hpp"
+#include "parallel.hpp"
+#include "ThreadPool.h"
+#include "quadTree.hpp"
+#include "aWindow.hpp"
+#include "aCamera.hpp"
+#include "discBatch.hpp"
+#include "log.hpp"
+#include "version.h"
+
+// Fill the store with a reproducible scene
+// uniform - radius 5 particles spread evenly, like the F-key spawner
+// clustered - a few dense clumps of radius 5 particles
+// mixed - uniform scene with every 50th particle enlarged to radius 50
+static void buildScene(particleStore& store, const std::string& scene, int count)
+{
+	std::mt19937 random(1234);
+	store.clear();
+	store.reserve(count);
+
+	if (scene == "clustered")
+	{
+		std::normal_distribution<double> spread(0, 150);
+		std::uniform_real_distribution<double> center(-4000, 4000);
+		std::vector<vector2d> clusters;
+		for (int i = 0; i < 16; ++i)
+		{
+			clusters.push_back({center(random), center(random)});
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			vector2d c = clusters[i % clusters.size()];
+			store.add({c.x + spread(random), c.y + spread(random)}, 5, 1);
+		}
+		return;
+	}
+
+	int side = int(std::ceil(std::sqrt(double(count))));
+	std::uniform_real_distribution<double> jitter(-1, 1);
+	for (int i = 0; i < count; ++i)
+	{
+		double radius = (scene == "mixed" && i % 50 == 0) ? 50 : 5;
+		vector2d position = {(i % side - side / 2) * 9.0 + jitter(random), (i / side - side / 2) * 9.0 + jitter(random)};
+		store.add(position, radius, 1);
+	}
+}
+
+// Run a function repeatedly and return the average time in milliseconds
+static double measure(const std::function<void()>& function, int repetitions)
+{
+	function(); // Warm up
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repetitions; ++i)
+	{
+		function();
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(end - start).count() / repetitions;
+}
+
+// Compare the build cost and candidate pairs of every broadphase on the same scenes
+static void benchBroadphase()
+{
+	fmt::print("{:<10} {:<15} {:>10} {:>12} {:>10} {:>14}\n", "scene", "broadphase", "particles", "build [ms]", "leaves", "pair tests");
+
+	for (std::string scene : {"uniform", "clustered", "mixed"})
+	{
+		for (int count : {10000, 100000})
+		{
+			particleStore store;
+			buildScene(store, scene, count);
+
+			for (broadphaseType type : {broadphaseType::quadTree, broadphaseType::linearQuadTree, broadphaseType::cellGrid})
+			{
+				broadphase* b = createBroadphase(type, 8192, 192/2, 20);
+
+				double buildTime = measure([&]() { b->build(store); }, 10);
+
+				std::vector<broadphaseLeaf> leaves;
+				b->getLeaves(leaves);
+				long long pairs = 0;
+				for (auto& leaf : leaves)
+				{
+					pairs += (long long)(leaf.count) * (leaf.count - 1);
+				}
+
+				fmt::print("{:<10} {:<15} {:>10} {:>12.3f} {:>10} {:>14}\n", scene, b->getName(), count, buildTime, leaves.size(), pairs);
+				delete b;
+			}
+		}
+	}
+}
+
+// Fill a new simulation with the particles of a scene
+static simulationContainer* createSimulation(const particleStore& scene, broadphaseType type)
+{
+	simulationContainer* container = new simulationContainer();
+	container->setBroadphase(type);
+	for (int i = 0; i < int(scene.x.size()); ++i)
+	{
+		container->addParticle({scene.x[i], scene.y[i]}, scene.radius[i]);
+	}
+	return container;
+}
+
+// Check that two simulations hold the same particles at bit-identical positions
+static bool compareState(simulationContainer* a, simulationContainer* b)
+{
+	if (a->getParticleCount() != b->getParticleCount())
+		return false;
+
+	for (int i = 0; i < a->getParticleCount(); ++i)
+	{
+		vector2d first = a->getParticle(i).getPosition();
+		vector2d second = b->getParticle(i).getPosition();
+		if (first.x != second.x || first.y != second.y)
+			return false;
+	}
+	return true;
+}
+
+// Check that two stores hold the same particles in the same order, with every column bit-identical
+static bool compareState(const particleStore& a, const particleStore& b)
+{
+	return a.x == b.x && a.y == b.y && a.vx == b.vx && a.vy == b.vy && a.ax == b.ax && a.ay == b.ay
+		&& a.radius == b.radius && a.inverseMass == b.inverseMass;
+}
+
+// Count the allocations of warmed up simulation ticks for every broadphase
+static void benchAllocations()
+{
+	if (!allocationStats::countsHeap())
+		fmt::print("heap allocations are not counted, configure with -DPARTICLES_COUNT_ALLOCATIONS=ON\n");
+
+	fmt::print("{:<15} {:>10} {:>16} {:>16} {:>14} {:>14}\n", "broadphase", "particles", "heap allocs/tick", "heap bytes/tick", "node blocks", "store growths");
+
+	particleStore scene;
+	buildScene(scene, "clustered", 10000);
+
+	for (broadphaseType type : {broadphaseType::quadTree, broadphaseType::linearQuadTree, broadphaseType::cellGrid})
+	{
+		simulationContainer* container = createSimulation(scene, type);
+
+		// Let the buffers reach their steady state size
+		for (int tick = 0; tick < 50; ++tick)
+		{
+			container->update();
+		}
+
+		const int ticks = 100;
+		long long allocations = allocationStats::heapAllocations.load();
+		long long bytes = allocationStats::heapBytes.load();
+		long long blocks = allocationStats::nodeBlocks.load();
+		long long growths = allocationStats::storeGrowths.load();
+		for (int tick = 0; tick < ticks; ++tick)
+		{
+			container->update();
+		}
+
+		fmt::print("{:<15} {:>10} {:>16} {:>16} {:>14} {:>14}\n", container->getBroadphaseName(), container->getParticleCount(),
+			(allocationStats::heapAllocations.load() - allocations) / ticks, (allocationStats::heapBytes.load() - bytes) / ticks,
+			allocationStats::nodeBlocks.load() - blocks, allocationStats::storeGrowths.load() - growths);
+
+		container->cleanUp();
+		delete container;
+	}
+}
+
+// Compare simulation ticks on spawn ordered and Z-ordered particle storage
+static void benchReorder()
+{
+	fmt::print("{:<10} {:<15} {:>10} {:>12}\n", "order", "broadphase", "particles", "tick [ms]");
+
+	// Clustered particles are spawned round-robin over the clusters, so neighbours are scattered in storage
+	particleStore scene;
+	buildScene(scene, "clustered", 100000);
+
+	for (bool reordering : {false, true})
+	{
+		for (broadphaseType type : {broadphaseType::quadTree, broadphaseType::linearQuadTree, broadphaseType::cellGrid})
+		{
+			simulationContainer* container = createSimulation(scene, type);
+			container->setReordering(reordering);
+
+			// Run past the first disorder check
+			for (int tick = 0; tick < 40; ++tick)
+			{
+				container->update();
+			}
+
+			double tickTime = measure([&]() { container->update(); }, 20);
+			fmt::print("{:<10} {:<15} {:>10} {:>12.3f}\n", reordering ? "z-order" : "spawn", container->getBroadphaseName(), container->getParticleCount(), tickTime);
+
+			container->cleanUp();
+			delete container;
+		}
+	}
+}
+
+// Compare the unordered and colored solver, and check if repeated runs end in the same state
+// The unordered solver writes shared particles from several threads, so only the colored solver has to be deterministic
+// Returns false if two colored runs ended in different states
+static bool benchSolver()
+{
+	bool passed = true;
+	fmt::print("{:<10} {:<15} {:>10} {:>12} {:>14}\n", "solver", "broadphase", "particles", "tick [ms]", "deterministic");
+
+	particleStore scene;
+	buildScene(scene, "clustered", 100000);
+
+	for (solverMode mode : {solverMode::unordered, solverMode::colored})
+	{
+		for (broadphaseType type : {broadphaseType::quadTree, broadphaseType::cellGrid})
+		{
+			simulationContainer* first = createSimulation(scene, type);
+			simulationContainer* second = createSimulation(scene, type);
+			first->setSolverMode(mode);
+			second->setSolverMode(mode);
+
+			double tickTime = measure([&]() { first->update(); }, 20);
+			for (int tick = 0; tick < 21; ++tick)
+			{
+				second->update();
+			}
+
+			bool deterministic = compareState(first, second);
+			bool reference = mode == solverMode::unordered;
+			if (!reference && !deterministic)
+				passed = false;
+
+			fmt::print("{:<10} {:<15} {:>10} {:>12.3f} {:>14}\n", reference ? "unordered" : "colored",
+				first->getBroadphaseName(), first->getParticleCount(), tickTime, deterministic ? "yes" : (reference ? "no" : "NO"));
+
+			first->cleanUp();
+			second->cleanUp();
+			delete first;
+			delete second;
+		}
+	}
+	return passed;
+}
+
+// Total momentum of the simulation and the sum of the momentum magnitudes, with the density of every scene being 1
+static void getMomentum(simulationContainer* container, vector2d& momentum, double& magnitude)
+{
+	momentum = {0, 0};
+	magnitude = 0;
+	for (int i = 0; i < container->getParticleCount(); ++i)
+	{
+		particle p = container->getParticle(i);
+		vector2d velocity = p.getVelocity();
+		momentum.x += velocity.x * p.getArea();
+		momentum.y += velocity.y * p.getArea();
+		magnitude += std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y) * p.getArea();
+	}
+}
+
+// Regression check of the pair kernels, collisions alone must not change the total momentum
+// The ordered kernel with the unordered solver is the previous behaviour
+// The unordered solver writes shared particles from several threads, so only the colored solver is held to the tolerance
+// Returns false if a colored solve drifted by more than it
+static bool benchMomentum()
+{
+	const double tolerance = 1e-9;
+	bool passed = true;
+	fmt::print("{:<10} {:<10} {:>10} {:>12} {:>16} {:>10}\n", "kernel", "solver", "particles", "solve [ms]", "momentum drift", "conserved");
+
+	particleStore scene;
+	buildScene(scene, "mixed", 10000);
+
+	for (bool halfPairs : {false, true})
+	{
+		for (solverMode mode : {solverMode::unordered, solverMode::colored})
+		{
+			simulationContainer* container = createSimulation(scene, broadphaseType::quadTree);
+			container->setHalfPairs(halfPairs);
+			container->setSolverMode(mode);
+
+			std::mt19937 random(99);
+			std::uniform_real_distribution<double> speed(-2, 2);
+			for (int i = 0; i < container->getParticleCount(); ++i)
+			{
+				container->getParticle(i).setVelocity({speed(random), speed(random)});
+			}
+
+			// Largest change of the total momentum during one solve, relative to the momentum in the system
+			double drift = 0;
+			double solveTime = measure([&]()
+			{
+				vector2d before, after;
+				double magnitude;
+				getMomentum(container, before, magnitude);
+				container->solveCollisions();
+				getMomentum(container, after, magnitude);
+				drift = std::max(drift, std::sqrt((after.x - before.x) * (after.x - before.x) + (after.y - before.y) * (after.y - before.y)) / magnitude);
+			}, 20);
+
+			bool reference = mode == solverMode::unordered;
+			bool conserved = drift <= tolerance;
+			if (!reference && !conserved)
+				passed = false;
+
+			fmt::print("{:<10} {:<10} {:>10} {:>12.3f} {:>16.3e} {:>10}\n", halfPairs ? "half" : "ordered", (mode == solverMode::colored) ? "colored" : "unordered",
+				container->getParticleCount(), solveTime, drift, reference ? "-" : (conserved ? "yes" : "NO"));
+
+			container->cleanUp();
+			delete container;
+		}
+	}
+	return passed;
+}
+
+// Compare the narrow phase instruction sets, every level must end in the same state as the scalar kernel
+// Returns false if a level ended in a different state
+static bool benchSimd()
+{
+	bool passed = true;
+	fmt::print("{:<10} {:<15} {:>10} {:>12} {:>14}\n", "simd", "broadphase", "particles", "solve [ms]", "bit-identical");
+
+	particleStore scene;
+	buildScene(scene, "mixed", 100000);
+
+	simdLevel supported = detectSimdLevel();
+	for (broadphaseType type : {broadphaseType::quadTree, broadphaseType::cellGrid})
+	{
+		std::vector<double> reference;
+		for (simdLevel level : {simdLevel::scalar, simdLevel::sse42, simdLevel::avx2})
+		{
+			if (level > supported)
+				continue;
+
+			simulationContainer* container = createSimulation(scene, type);
+			container->setSimdLevel(level);
+
+			double solveTime = measure([&]() { container->solveCollisions(); }, 10);
+
+			std::vector<double> state;
+			for (int i = 0; i < container->getParticleCount(); ++i)
+			{
+				particle p = container->getParticle(i);
+				state.insert(state.end(), {p.getPosition().x, p.getPosition().y, p.getVelocity().x, p.getVelocity().y});
+			}
+			if (level == simdLevel::scalar)
+				reference = state;
+
+			bool identical = state.size() == reference.size() && std::memcmp(state.data(), reference.data(), state.size() * sizeof(double)) == 0;
+			if (!identical)
+				passed = false;
+			fmt::print("{:<10} {:<15} {:>10} {:>12.3f} {:>14}\n", getSimdLevelName(level), container->getBroadphaseName(), container->getParticleCount(), solveTime, identical ? "yes" : "NO");
+
+			container->cleanUp();
+			delete container;
+		}
+	}
+	return passed;
+}
+
+// Compare the partition modes of the solver on scenes with even and uneven leaves
+static void benchPartition()
+{
+	fmt::print("{:<10} {:<10} {:<15} {:>10} {:>12}\n", "partition", "scene", "broadphase", "particles", "solve [ms]");
+
+	for (std::string sceneName : {"uniform", "clustered"})
+	{
+		particleStore scene;
+		buildScene(scene, sceneName, 100000);
+
+		for (partitionMode mode : {partitionMode::staticChunks, partitionMode::dynamic, partitionMode::guided})
+		{
+			simulationContainer* container = createSimulation(scene, broadphaseType::quadTree);
+			container->setPartitionMode(mode);
+
+			double solveTime = measure([&]() { container->solveCollisions(); }, 10);
+
+			std::string modeName = (mode == partitionMode::staticChunks) ? "static" : (mode == partitionMode::dynamic) ? "dynamic" : "guided";
+			fmt::print("{:<10} {:<10} {:<15} {:>10} {:>12.3f}\n", modeName, sceneName, container->getBroadphaseName(), container->getParticleCount(), solveTime);
+
+			container->cleanUp();
+			delete container;
+		}
+	}
+}
+
+// Print the time and heap allocations per task of a scheduling pattern
+static void printScheduling(const std::string& pattern, const std::string& scheduler, int tasks, const std::function<void()>& function)
+{
+	long long allocations = allocationStats::heapAllocations.load();
+	double time = measure(function, 5);
+	double allocationsPerTask = double(allocationStats::heapAllocations.load() - allocations) / (6.0 * tasks);
+
+	fmt::print("{:<12} {:<15} {:>10} {:>14.1f} {:>16}\n", pattern, scheduler, tasks, time * 1e6 / tasks,
+		allocationStats::countsHeap() ? fmt::format("{:.2f}", allocationsPerTask) : "-");
+}
+
+// Compare the ThreadPool with the work-stealing taskScheduler
+// flat - submit many tiny tasks and wait for all of them
+// forkJoin - many short rounds of a few tasks, like the solver's colors and iterations
+// nested - tasks spawning tasks, which the ThreadPool can't wait for without blocking a worker
+static void benchScheduler()
+{
+	int threads = std::max(1, int(std::thread::hardware_concurrency()));
+	fmt::print("{} threads\n", threads);
+	fmt::print("{:<12} {:<15} {:>10} {:>14} {:>16}\n", "pattern", "scheduler", "tasks", "ns per task", "allocs per task");
+
+	std::atomic<long long> sink(0);
+	const int flatTasks = 100000;
+	const int rounds = 2000;
+	const int roundTasks = 16;
+
+	{
+		ThreadPool* pool = new ThreadPool(threads);
+		std::vector<std::future<void>> futures;
+
+		printScheduling("flat", "ThreadPool", flatTasks, [&]()
+		{
+			futures.clear();
+			for (int i = 0; i < flatTasks; ++i)
+			{
+				futures.push_back(pool->enqueue([&sink, i]() { sink.fetch_add(i, std::memory_order_relaxed); }));
+			}
+			for (auto& future : futures)
+			{
+				future.get();
+			}
+		});
+
+		printScheduling("forkJoin", "ThreadPool", rounds * roundTasks, [&]()
+		{
+			for (int round = 0; round < rounds; ++round)
+			{
+				futures.clear();
+				for (int i = 0; i < roundTasks; ++i)
+				{
+					futures.push_back(pool->enqueue([&sink, i]() { sink.fetch_add(i, std::memory_order_relaxed); }));
+				}
+				for (auto& future : futures)
+				{
+					future.get();
+				}
+			}
+		});
+
+		delete pool;
+	}
+
+	{
+		taskScheduler* scheduler = new taskScheduler(threads);
+		auto add = [&sink](size_t begin, size_t) { sink.fetch_add((long long)(begin), std::memory_order_relaxed); };
+
+		printScheduling("flat", "taskScheduler", flatTasks, [&]()
+		{
+			taskGroup group;
+			for (int i = 0; i < flatTasks; ++i)
+			{
+				scheduler->submit(group, add, i, i + 1);
+			}
+			scheduler->wait(group);
+		});
+
+		printScheduling("forkJoin", "taskScheduler", rounds * roundTasks, [&]()
+		{
+			for (int round = 0; round < rounds; ++round)
+			{
+				taskGroup group;
+				for (int i = 0; i < roundTasks; ++i)
+				{
+					scheduler->submit(group, add, i, i + 1);
+				}
+				scheduler->wait(group);
+			}
+		});
+
+		// Every task splits its range in halves until single items remain
+		std::function<void(size_t, size_t)> split = [&](size_t begin, size_t end)
+		{
+			if (end - begin == 1)
+			{
+				sink.fetch_add((long long)(begin), std::memory_order_relaxed);
+				return;
+			}
+
+			taskGroup group;
+			size_t middle = (begin + end) / 2;
+			scheduler->submit(group, split, begin, middle);
+			scheduler->submit(group, split, middle, end);
+			scheduler->wait(group);
+		};
+
+		printScheduling("nested", "taskScheduler", flatTasks * 2 - 1, [&]()
+		{
+			split(0, flatTasks);
+		});
+
+		delete scheduler;
+	}
+}
+
+// Compare removing particles one by one with a stable compaction of the survivors, and check that both keep the same particles in the same order
+// Returns false if the compaction kept other particles than the erasing
+static bool benchRemoval()
+{
+	bool passed = true;
+	int threads = std::max(1, int(std::thread::hardware_concurrency()));
+	taskScheduler* scheduler = new taskScheduler(threads);
+	fmt::print("{:<10} {:>10} {:>10} {:>14} {:>10}\n", "removed", "method", "particles", "remove [ms]", "equal");
+
+	for (int stride : {1000, 100, 10})
+	{
+		particleStore scene;
+		buildScene(scene, "uniform", 100000);
+		auto removed = [stride](size_t p) { return p % stride == 7; };
+
+		particleStore erased = scene;
+		double eraseTime = measure([&]()
+		{
+			erased = scene;
+			for (int p = erased.getCount(); p > 0; --p)
+			{
+				if (removed(p - 1))
+					erased.erase(p - 1);
+			}
+		}, 5);
+
+		particleStore compacted = scene;
+		std::vector<int> kept;
+		double compactTime = measure([&]()
+		{
+			compacted = scene;
+			size_t remaining = parallelCompact(*scheduler, compacted.getCount(), [&](size_t p) { return !removed(p); }, kept);
+			if (remaining < size_t(compacted.getCount()))
+				compacted.reorder(kept, scheduler);
+		}, 5);
+
+		bool equal = compareState(erased, compacted);
+		if (!equal)
+			passed = false;
+		std::string share = fmt::format("1/{}", stride);
+		fmt::print("{:<10} {:>10} {:>10} {:>14.3f} {:>10}\n", share, "erase", erased.getCount(), eraseTime, "");
+		fmt::print("{:<10} {:>10} {:>10} {:>14.3f} {:>10}\n", share, "compact", compacted.getCount(), compactTime, equal ? "yes" : "NO");
+	}
+
+	delete scheduler;
+	return passed;
+}
+
+// Compare fork-join and phased ticks, and check that both end in the same state
+// Returns false if they ended in different states
+static bool benchPhases()
+{
+	bool passed = true;
+	fmt::print("{:<10} {:>8} {:>10} {:>12} {:>10}\n", "execution", "threads", "particles", "tick [ms]", "equal");
+
+	int cores = int(taskScheduler::getAvailableCores().size());
+	for (int count : {10000, 100000})
+	{
+		particleStore scene;
+		buildScene(scene, "clustered", count);
+
+		for (int threads : {0, std::max(4, cores)})
+		{
+			simulationContainer* forkJoin = createSimulation(scene, broadphaseType::quadTree);
+			simulationContainer* phased = createSimulation(scene, broadphaseType::quadTree);
+			forkJoin->setSchedulerSettings(schedulerSettings(threads));
+			phased->setSchedulerSettings(schedulerSettings(threads));
+			forkJoin->setExecutionMode(executionMode::forkJoin);
+			phased->setExecutionMode(executionMode::phased);
+
+			double forkJoinTime = measure([&]() { forkJoin->update(); }, 20);
+			double phasedTime = measure([&]() { phased->update(); }, 20);
+
+			bool equal = compareState(forkJoin, phased);
+			if (!equal)
+				passed = false;
+
+			std::string threadName = (threads == 0) ? "default" : std::to_string(threads);
+			fmt::print("{:<10} {:>8} {:>10} {:>12.3f} {:>10}\n", "forkJoin", threadName, count, forkJoinTime, "");
+			fmt::print("{:<10} {:>8} {:>10} {:>12.3f} {:>10}\n", "phased", threadName, count, phasedTime, equal ? "yes" : "NO");
+
+			forkJoin->cleanUp();
+			phased->cleanUp();
+			delete forkJoin;
+			delete phased;
+		}
+	}
+	return passed;
+}
+
+// Compare the execution modes on whole frames, a tick plus the quads of the particles, and check that they end in the same state
+// Returns false if a mode ended in a different state than fork-join
+static bool benchExecution()
+{
+	bool passed = true;
+	fmt::print("{:<10} {:>10} {:>12} {:>10}\n", "execution", "particles", "frame [ms]", "equal");
+
+	for (int count : {10000, 100000})
+	{
+		particleStore scene;
+		buildScene(scene, "clustered", count);
+
+		simulationContainer* reference = nullptr;
+		for (executionMode mode : {executionMode::forkJoin, executionMode::phased, executionMode::graph})
+		{
+			simulationContainer* container = createSimulation(scene, broadphaseType::quadTree);
+			container->setExecutionMode(mode);
+			simulationRenderer renderer(container);
+
+			double frameTime = measure([&]()
+			{
+				container->update();
+				container->acquireSnapshot();
+				renderer.getDiscs().begin(1, vector2d(1280, 720), 2560, 1440);
+				renderer.prepareDiscs(1);
+			}, 20);
+
+			bool equal = true;
+			if (reference == nullptr)
+			{
+				reference = container;
+			}
+			else
+			{
+				equal = compareState(reference, container);
+				if (!equal)
+					passed = false;
+			}
+
+			std::string modeName = (mode == executionMode::forkJoin) ? "forkJoin" : (mode == executionMode::phased) ? "phased" : "graph";
+			fmt::print("{:<10} {:>10} {:>12.3f} {:>10}\n", modeName, count, frameTime, equal ? "yes" : "NO");
+
+			if (container != reference)
+			{
+				container->cleanUp();
+				delete container;
+			}
+		}
+		reference->cleanUp();
+		delete reference;
+	}
+	return passed;
+}
+
+// Write the quads of the particles one by one and in parallel chunks, and check that both draw the same discs in the same order
+// The view covers the middle of the scene, so the chunks cull particles as well
+// Returns false if the chunks drew other discs than the serial pass
+static bool benchDiscs()
+{
+	bool passed = true;
+	fmt::print("{:<10} {:>8} {:>10} {:>12} {:>10}\n", "particles", "workers", "drawn", "quads [ms]", "equal");
+
+	for (int count : {100000, 1000000})
+	{
+		particleStore scene;
+		buildScene(scene, "uniform", count);
+		simulationContainer* container = createSimulation(scene, broadphaseType::quadTree);
+		container->update();
+		container->acquireSnapshot();
+		const particleSnapshot& snapshot = container->getSnapshot();
+
+		discBatch serial;
+		double serialTime = measure([&]()
+		{
+			serial.begin(1, vector2d(1280, 720), 2560, 1440);
+			for (size_t p = 0; p < snapshot.x.size(); ++p)
+			{
+				double speed = std::sqrt(snapshot.vx[p] * snapshot.vx[p] + snapshot.vy[p] * snapshot.vy[p]);
+				serial.add({snapshot.x[p], snapshot.y[p]}, snapshot.radius[p], getSpeedColor(speed));
+			}
+		}, 10);
+		fmt::print("{:<10} {:>8} {:>10} {:>12.3f} {:>10}\n", count, "serial", serial.getCount(), serialTime, "");
+
+		std::vector<int> workerCounts = {1};
+		if (int(std::thread::hardware_concurrency()) > 2)
+			workerCounts.push_back(std::min(int(std::thread::hardware_concurrency()) - 1, simulationRenderer::maxWorkers));
+		for (int workers : workerCounts)
+		{
+			simulationRenderer renderer(container, schedulerSettings(workers));
+			discBatch& discs = renderer.getDiscs();
+			double parallelTime = measure([&]()
+			{
+				discs.begin(1, vector2d(1280, 720), 2560, 1440);
+				renderer.prepareDiscs(1);
+			}, 10);
+
+			// The ranges of the chunks, one after the other, hold the discs in the order they were added one by one
+			bool equal = discs.getCount() == serial.getCount();
+			int next = 0;
+			for (auto [first, drawn] : discs.getRanges())
+			{
+				equal = equal && std::memcmp(discs.getVertices() + size_t(first) * 4, serial.getVertices() + size_t(next) * 4, sizeof(SDL_Vertex) * 4 * drawn) == 0;
+				next += drawn;
+			}
+			if (!equal)
+				passed = false;
+			fmt::print("{:<10} {:>8} {:>10} {:>12.3f} {:>10}\n", count, workers, discs.getCount(), parallelTime, equal ? "yes" : "NO");
+		}
+
+		container->cleanUp();
+		delete container;
+	}
+	return passed;
+}
+
+// Cost of a log call on the logging threads, and how long the writer needs to catch up
+// info - distinct messages, every one ends up in the history
+// error - the same error over and over, which the history counts on one entry
+static void benchLog()
+{
+	log::initFile("bench_log.txt");
+	fmt::print("{:<8} {:>8} {:>10} {:>14} {:>12}\n", "message", "threads", "messages", "call [ns]", "flush [ms]");
+
+	int messages = 1000;
+	for (std::string kind : {"info", "error"})
+	{
+		for (int threads : {1, 2, 4})
+		{
+			auto logMessages = [&kind, messages](int thread)
+			{
+				for (int i = 0; i < messages; ++i)
+				{
+					if (kind == "info")
+						log::info("benchLog - Message {} of thread {}", i, thread);
+					else
+						log::error("benchLog - Repeated error");
+				}
+			};
+
+			auto start = std::chrono::steady_clock::now();
+			std::vector<std::thread> loggers;
+			for (int t = 0; t < threads; ++t)
+			{
+				loggers.emplace_back(logMessages, t);
+			}
+			for (auto& logger : loggers)
+			{
+				logger.join();
+			}
+			auto logged = std::chrono::steady_clock::now();
+			log::flush();
+			auto flushed = std::chrono::steady_clock::now();
+
+			double callTime = std::chrono::duration<double, std::nano>(logged - start).count() / messages;
+			double flushTime = std::chrono::duration<double, std::milli>(flushed - logged).count();
+			fmt::print("{:<8} {:>8} {:>10} {:>14.1f} {:>12.3f}\n", kind, threads, messages * threads, callTime, flushTime);
+		}
+	}
+}
+
+// Timing samples of one case of the suite, reported as percentiles
+struct suiteRecord
+{
+	std::string name;
+	std::vector<std::pair<std::string, double>> parameters;
+	std::string unit;
+	std::vector<double> samples;
+};
+
+static std::vector<suiteRecord> suiteRecords;
+
+// Run a function repeatedly after a warm up and return the time of every run in milliseconds
+static std::vector<double> sample(const std::function<void()>& function, int repetitions)
+{
+	function();
+	std::vector<double> samples(repetitions);
+	for (int i = 0; i < repetitions; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		function();
+		auto end = std::chrono::steady_clock::now();
+		samples[i] = std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	return samples;
+}
+
+// Linearly interpolated percentile p in [0, 100] of sorted samples
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+
+	double rank = p / 100 * (sorted.size() - 1);
+	size_t lower = size_t(rank);
+	size_t upper = std::min(lower + 1, sorted.size() - 1);
+	return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+}
+
+// Store the samples of a case, scaled into its unit, and print its summary
+static void record(const std::string& name, std::vector<std::pair<std::string, double>> parameters, const std::string& unit, std::vector<double> samples, double scale = 1)
+{
+	for (double& s : samples)
+	{
+		s *= scale;
+	}
+	std::sort(samples.begin(), samples.end());
+
+	std::string parameterText;
+	for (auto& [key, value] : parameters)
+	{
+		parameterText += fmt::format("{}{}={}", parameterText.empty() ? "" : " ", key, value);
+	}
+	fmt::print("{:<22} {:<28} {:>12.4g} {:>12.4g} {:>12.4g} {:>8}\n", name, parameterText,
+		percentile(samples, 50), percentile(samples, 90), percentile(samples, 99), unit);
+
+	suiteRecords.push_back({name, std::move(parameters), unit, std::move(samples)});
+}
+
+// Write every recorded case as JSON, with min, percentiles, max and mean of its samples
+static void writeSuiteReport(const std::string& filePath)
+{
+	FILE* file = fopen(filePath.c_str(), "w");
+	if (file == nullptr)
+	{
+		fmt::print("Could not open {} for writing\n", filePath);
+		return;
+	}
+
+	fmt::print(file, "{{\n  \"version\": \"{}\",\n  \"hardwareThreads\": {},\n  \"benchmarks\": [\n", APP_VERSION, std::thread::hardware_concurrency());
+	for (size_t r = 0; r < suiteRecords.size(); ++r)
+	{
+		const suiteRecord& entry = suiteRecords[r];
+		double sum = 0;
+		for (double s : entry.samples)
+		{
+			sum += s;
+		}
+
+		std::string parameters;
+		for (auto& [key, value] : entry.parameters)
+		{
+			parameters += fmt::format("{}\"{}\": {}", parameters.empty() ? "" : ", ", key, value);
+		}
+
+		fmt::print(file, "    {{\"name\": \"{}\", \"parameters\": {{{}}}, \"unit\": \"{}\", \"samples\": {}, "
+			"\"min\": {}, \"p50\": {}, \"p90\": {}, \"p99\": {}, \"max\": {}, \"mean\": {}}}{}\n",
+			entry.name, parameters, entry.unit, entry.samples.size(),
+			entry.samples.front(), percentile(entry.samples, 50), percentile(entry.samples, 90), percentile(entry.samples, 99),
+			entry.samples.back(), sum / entry.samples.size(), (r + 1 < suiteRecords.size()) ? "," : "");
+	}
+	fmt::print(file, "  ]\n}}\n");
+	fclose(file);
+
+	fmt::print("Wrote {} benchmarks to {}\n", suiteRecords.size(), filePath);
+}
+
+// Build a quadtree from scratch by splitting a root holding every particle, then collect its leaves
+// The particles are spread uniformly over the simulation space, so the count sets the density
+static void suiteQuadTree()
+{
+	const double halfDimension = 8192;
+	const int capacity = 96;
+
+	for (int count : {10000, 100000, 1000000})
+	{
+		particleStore store;
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<double> coordinate(-halfDimension, halfDimension);
+		store.reserve(count);
+		for (int i = 0; i < count; ++i)
+		{
+			store.add({coordinate(random), coordinate(random)}, 5, 1);
+		}
+
+		quadTreePool pool(capacity);
+		quadTreeHomes homes;
+		homes.leaf.resize(count);
+		homes.slot.resize(count);
+		std::vector<quadTree*> quads;
+		quadTree* root = nullptr;
+
+		auto fill = [&]()
+		{
+			pool.reset();
+			root = pool.acquire({vector2d(0, 0), halfDimension}, nullptr);
+			for (int i = 0; i < count; ++i)
+			{
+				root->insertParticle(i, {store.x[i], store.y[i]}, homes);
+			}
+		};
+
+		int repetitions = (count >= 1000000) ? 5 : 30;
+		std::vector<double> splitSamples;
+		for (int r = 0; r <= repetitions; ++r)
+		{
+			fill();
+			auto start = std::chrono::steady_clock::now();
+			root->restructure(store, homes, pool);
+			auto end = std::chrono::steady_clock::now();
+			if (r > 0)
+				splitSamples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		record("quadTree::split", {{"particles", count}}, "ms", splitSamples);
+
+		quads.reserve(count);
+		record("quadTree::getLeaves", {{"particles", count}}, "ms", sample([&]()
+		{
+			quads.clear();
+			root->getLeaves(quads);
+		}, repetitions * 10));
+	}
+}
+
+// Solve a single leaf of a packed pile of particles, reported per candidate pair so leaf sizes compare directly
+// The pile settles during the warm up, so the samples measure resting contacts
+static void suiteWorker()
+{
+	for (int size : {8, 16, 32, 64, 96, 128, 256})
+	{
+		simulationContainer* container = new simulationContainer(schedulerSettings(0));
+		int side = int(std::ceil(std::sqrt(double(size))));
+		for (int i = 0; i < size; ++i)
+		{
+			container->addParticle({(i % side) * 8.0, (i / side) * 8.0}, 5);
+		}
+
+		std::vector<int> indices(size);
+		for (int i = 0; i < size; ++i)
+		{
+			indices[i] = i;
+		}
+		broadphaseLeaf leaf = {quadTreeBox({0, 0}, side * 8.0), indices.data(), size, size};
+
+		const int solves = 1000;
+		double pairs = double(size) * (size - 1) / 2;
+		std::vector<double> samples = sample([&]()
+		{
+			for (int i = 0; i < solves; ++i)
+			{
+				container->solveLeaf(leaf);
+			}
+		}, 50);
+		record("simulation::worker", {{"leafSize", size}}, "ns/pair", samples, 1e6 / (solves * pairs));
+
+		container->cleanUp();
+		delete container;
+	}
+}
+
+// Whole ticks of the default configuration on the uniform scene
+static void suiteUpdate()
+{
+	for (int count : {10000, 100000, 1000000})
+	{
+		particleStore scene;
+		buildScene(scene, "uniform", count);
+		simulationContainer* container = createSimulation(scene, broadphaseType::quadTree);
+
+		int repetitions = (count >= 1000000) ? 5 : (count >= 100000) ? 20 : 100;
+		record("simulation::update", {{"particles", count}}, "ms", sample([&]() { container->update(); }, repetitions));
+
+		container->cleanUp();
+		delete container;
+	}
+}
+
+// Cost of handing a task to a pool and waiting for it, per task
+static void suiteEnqueue()
+{
+	const int tasks = 10000;
+	int threads = std::max(1, int(std::thread::hardware_concurrency()) - 1);
+
+	ThreadPool pool(threads);
+	std::vector<std::future<void>> futures;
+	futures.reserve(tasks);
+	record("ThreadPool::enqueue", {{"threads", threads}, {"tasks", tasks}}, "us/task", sample([&]()
+	{
+		futures.clear();
+		for (int i = 0; i < tasks; ++i)
+		{
+			futures.push_back(pool.enqueue([]() {}));
+		}
+		for (auto& f : futures)
+		{
+			f.wait();
+		}
+	}, 30), 1000.0 / tasks);
+
+	// The work-stealing scheduler of the simulation, for comparison
+	taskScheduler scheduler(threads);
+	taskGroup group;
+	auto empty = [](size_t, size_t) {};
+	record("taskScheduler::submit", {{"threads", threads}, {"tasks", tasks}}, "us/task", sample([&]()
+	{
+		for (int i = 0; i < tasks; ++i)
+		{
+			scheduler.submit(group, empty, i, i + 1);
+		}
+		scheduler.wait(group);
+	}, 30), 1000.0 / tasks);
+}
+
+// Frames of discs drawn through aCamera on SDL's software renderer without showing a window, one texture draw per disc or one batch
+static void suiteRenderDisc()
+{
+	SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+	SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+	if (!SDL_Init(SDL_INIT_VIDEO))
+	{
+		fmt::print("aCamera::renderDisc and renderDiscs skipped, no offscreen video driver: {}\n", SDL_GetError());
+		return;
+	}
+	TTF_Init();
+
+	aWindow* window = new aWindow("particles_bench", 1280, 720);
+	aCamera* camera = new aCamera(1280, 720, window);
+	camera->loadTextures();
+
+	for (int count : {1000, 10000, 100000})
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<double> coordinate(-120, 120);
+		std::vector<vector2d> positions(count);
+		for (vector2d& p : positions)
+		{
+			p = {coordinate(random), coordinate(random) * 0.5};
+		}
+
+		int repetitions = (count >= 100000) ? 10 : 50;
+		record("aCamera::renderDisc", {{"discs", count}}, "ms/frame", sample([&]()
+		{
+			window->clear();
+			for (vector2d p : positions)
+			{
+				camera->renderDisc(p, 1, {255, 255, 255, 255}, false);
+			}
+			window->display();
+		}, repetitions));
+
+		discBatch batch;
+		record("aCamera::renderDiscs", {{"discs", count}}, "ms/frame", sample([&]()
+		{
+			window->clear();
+			camera->beginDiscs(batch);
+			for (vector2d p : positions)
+			{
+				batch.add(p, 1, {255, 255, 255, 255});
+			}
+			camera->renderDiscs(batch);
+			window->display();
+		}, repetitions));
+	}
+
+	camera->cleanUp();
+	window->cleanUp();
+	delete camera;
+	delete window;
+	TTF_Quit();
+	SDL_Quit();
+}
+
+// Reproducible suite of the solver, broadphase, scheduler and renderer, written as JSON for tracking regressions between releases
+static void benchSuite(const std::string& filePath)
+{
+	fmt::print("{:<22} {:<28} {:>12} {:>12} {:>12} {:>8}\n", "benchmark", "parameters", "p50", "p90", "p99", "unit");
+
+	suiteQuadTree();
+	suiteWorker();
+	suiteUpdate();
+	suiteEnqueue();
+	suiteRenderDisc();
+
+	writeSuiteReport(filePath);
+}
+
+int main(int argc, char* args[])
+{
+	std::string filter = (argc > 1) ? args[1] : "";
+	bool passed = true; // Checks that fail make the exit status non-zero
+
+	if (filter.empty() || filter == "broadphase")
+		benchBroadphase();
+
+	if (filter.empty() || filter == "allocations")
+		benchAllocations();
+
+	if (filter.empty() || filter == "reorder")
+		benchReorder();
+
+	if (filter.empty() || filter == "solver")
+		passed = benchSolver() && passed;
+
+	if (filter.empty() || filter == "momentum")
+		passed = benchMomentum() && passed;
+
+	if (filter.empty() || filter == "simd")
+		passed = benchSimd() && passed;
+
+	if (filter.empty() || filter == "scheduler")
+		benchScheduler();
+
+	if (filter.empty() || filter == "partition")
+		benchPartition();
+
+	if (filter.empty() || filter == "removal")
+		passed = benchRemoval() && passed;
+
+	if (filter.empty() || filter == "phases")
+		passed = benchPhases() && passed;
+
+	if (filter.empty() || filter == "execution")
+		passed = benchExecution() && passed;
+
+	if (filter.empty() || filter == "discs")
+		passed = benchDiscs() && passed;
+
+	if (filter.empty() || filter == "log")
+		benchLog();
+
+	// particles_bench suite [output file], the suite writes its results as JSON
+	if (filter.empty() || filter == "suite")
+		benchSuite((argc > 2) ? args[2] : "bench_results.json");
+
+	return passed ? 0 : 1;
+}
@@ -9,9 +9,12 @@
 
 #include "aWindow.hpp"
 #include "math.hpp"
+#include "discBatch.hpp"
 
 class aWindow;
 
+SDL_Color interpolateColor(const SDL_Color& color1, const SDL_Color& color2, double factor);
+
 class aCamera
 {
 public:
@@ -38,6 +41,12 @@ public:
 
 	void renderDisc(vector2d discPosition, double radius, SDL_Color color, bool UI);
 
+	// Start a batch of discs in world coordinates, drawn through the current view
+	void beginDiscs(discBatch& batch);
+
+	// Draw the discs of a batch with the disc texture
+	void renderDiscs(discBatch& batch);
+
 	void renderRect(SDL_FRect rect, SDL_Color color, bool UI);
 
 	void renderText(vector2d position, double height, std::string alignment, std::string text, SDL_Color color, bool UI);
@@ -44,6 +44,9 @@ public:
 
 	void renderTexture(SDL_Texture* texture, SDL_FRect* source, SDL_FRect* destination, double angle, SDL_Color color);
 
+	// Draw triangles in pixels of the screen texture, colored by their vertices only
+	void renderGeometry(SDL_Texture* texture, const SDL_Vertex* vertices, int vertexCount, const int* indices, int indexCount);
+
 	void updateSize(int nWidth, int nHeight);
 
 private:
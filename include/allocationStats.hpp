@@ -0,0 +1,16 @@
+#pragma once
+
+#include <atomic>
+
+// Process wide allocation counters, used to check that steady state ticks don't touch the heap
+// Heap allocations are only counted when built with PARTICLES_COUNT_ALLOCATIONS,
+// which replaces the global operator new
+struct allocationStats
+{
+	static std::atomic<long long> heapAllocations; // Calls to the global operator new
+	static std::atomic<long long> heapBytes; // Bytes requested from the global operator new
+	static std::atomic<long long> nodeBlocks; // Node blocks allocated by every quadTreePool
+	static std::atomic<long long> storeGrowths; // Reallocations of the particleStore columns
+
+	static bool countsHeap();
+};
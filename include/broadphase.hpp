@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "math.hpp"
+#include "particleStore.hpp"
+#include "quadTree.hpp"
+
+// A group of particles the solver tests against each other
+// Every particle is home in exactly one leaf, where it is listed before the ghosts of other leaves.
+// The home leaf of a particle also holds every particle whose expanded bounds contain its center,
+// so every overlapping pair meets in the home leaf of each of its particles
+struct broadphaseLeaf
+{
+	quadTreeBox boundary;
+	const int* particles;
+	int count;
+	int homeCount; // Number of leading particles that are home in this leaf
+};
+
+enum class broadphaseType
+{
+	quadTree,
+	linearQuadTree,
+	cellGrid
+};
+
+// Interface of the spatial structures used to find collision candidates
+class broadphase
+{
+public:
+	virtual ~broadphase() = default;
+
+	// Rebuild the structure from the current particle positions
+	virtual void build(particleStore& store) = 0;
+
+	// Retrieve all non-empty leaves of the last build
+	virtual void getLeaves(std::vector<broadphaseLeaf>& leaves) = 0;
+
+	// Release everything built so far
+	virtual void clear() = 0;
+
+	virtual std::string getName() = 0;
+};
+
+broadphase* createBroadphase(broadphaseType type, double halfDimension, int capacity, double cellSize);
+
+// Cycle through all available broadphase types
+broadphaseType nextBroadphaseType(broadphaseType type);
+
+// Name of a broadphase type, as used in scenario files
+std::string getBroadphaseTypeName(broadphaseType type);
+
+// Look up a broadphase type by its name, returns false if there is none of that name
+bool findBroadphaseType(const std::string& name, broadphaseType& type);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "broadphase.hpp"
+
+// Uniform grid broadphase stored as a spatial hash
+// Particles are binned with a counting sort, so a build is two linear passes
+class cellGrid : public broadphase
+{
+public:
+	cellGrid(double nHalfDimension, double nMinCellSize);
+
+	void build(particleStore& store) override;
+	void getLeaves(std::vector<broadphaseLeaf>& leaves) override;
+	void clear() override;
+	std::string getName() override;
+
+private:
+	int getSlot(int cellX, int cellY);
+	int getCells(particleStore& store, int index, int* slots);
+
+	double halfDimension;
+	double minCellSize;
+	double cellSize;
+
+	int slotMask;
+
+	std::vector<int> slotStart; // Offset of every slot inside entries, one past the end for the last slot
+	std::vector<int> slotCursor;
+	std::vector<int> slotHomeCount; // Number of particles centered in the cells of every slot
+	std::vector<int64_t> slotCell; // Packed coordinates of the first cell mapped to each slot
+	std::vector<int> entries; // Particle indices ordered by slot
+	std::vector<int> particleSlots; // Up to four slots per particle
+};
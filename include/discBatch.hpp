@@ -0,0 +1,74 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "math.hpp"
+
+// Discs of a frame as textured quads with a color per vertex, drawn with a few SDL_RenderGeometry calls
+// instead of a texture draw per disc. The vertices are in pixels of the render target, the batch keeps
+// its buffers between frames, so it stops allocating once it held the largest frame
+// Discs are either added one by one, or written to their slots by several threads, which then add the ranges of slots they filled
+class discBatch
+{
+public:
+	static constexpr int discsPerCall = 1 << 16; // Discs per SDL_RenderGeometry call, which all share one index buffer
+
+	discBatch();
+
+	// Drop the discs of the last frame and take over a world to pixel transform, pixel = world * scale + offset
+	// Discs entirely outside of [0, targetWidth] x [0, targetHeight] are left out
+	void begin(double nScale, vector2d nOffset, double nTargetWidth, double nTargetHeight);
+
+	// Add a disc given in world coordinates
+	void add(vector2d position, double radius, SDL_Color color);
+
+	// Make room for discs in the slots [0, discs), which setDisc may then fill from any thread
+	void reserve(int discs);
+
+	// Write a disc given in world coordinates to a slot, returns false without writing it if it is off the target
+	inline bool setDisc(int slot, double x, double y, double radius, SDL_Color color)
+	{
+		// Like aWindow::renderTexture, a disc covers at least a pixel
+		x = x * scale + offset.x;
+		y = y * scale + offset.y;
+		double r = std::max(radius * scale, 0.5);
+		if (x - r > targetWidth || y - r > targetHeight || x + r < 0 || y + r < 0)
+			return false;
+
+		SDL_FColor vertexColor = {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f};
+		float left = float(x - r);
+		float top = float(y - r);
+		float right = float(x + r);
+		float bottom = float(y + r);
+
+		SDL_Vertex* quad = &vertices[size_t(slot) * 4];
+		quad[0] = {{left, top}, vertexColor, {0, 0}};
+		quad[1] = {{right, top}, vertexColor, {1, 0}};
+		quad[2] = {{right, bottom}, vertexColor, {1, 1}};
+		quad[3] = {{left, bottom}, vertexColor, {0, 1}};
+		return true;
+	}
+
+	// Draw the discs in the slots [first, first + discs), once every thread finished writing them
+	void addRange(int first, int discs);
+
+	int getCount();
+	const std::vector<std::pair<int, int>>& getRanges();
+	const SDL_Vertex* getVertices();
+	const int* getIndices();
+
+private:
+	std::vector<SDL_Vertex> vertices; // Four per slot, never shrinks
+	std::vector<int> indices; // Two triangles for each of discsPerCall discs, built once
+	std::vector<std::pair<int, int>> ranges; // First slot and number of discs of every run of filled slots
+	int count; // Discs in all ranges
+
+	double scale;
+	vector2d offset;
+	double targetWidth;
+	double targetHeight;
+};
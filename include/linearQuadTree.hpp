@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "broadphase.hpp"
+
+// Node of a linearQuadTree, addressed by its index in the node array
+struct linearQuadTreeNode
+{
+	quadTreeBox boundary;
+	int begin; // Range of the node inside the sorted particle array
+	int end;
+	int parent;
+	int firstChild; // Index of the first of four consecutive children, -1 for leaves
+	int leaf; // Index of the leaf, -1 for internal nodes
+};
+
+// Pointerless quadtree built from the particles sorted along a Z-order curve
+// Nodes live in one flat array and every leaf is a contiguous range of a single index array
+class linearQuadTree : public broadphase
+{
+public:
+	linearQuadTree(double nHalfDimension, int nCapacity);
+
+	void build(particleStore& store) override;
+	void getLeaves(std::vector<broadphaseLeaf>& leaves) override;
+	void clear() override;
+	std::string getName() override;
+
+private:
+	void split(int node, int level);
+	void insertGhost(int node, int index, quadTreeBox bounds, int home);
+
+	double halfDimension;
+	int capacity;
+
+	std::vector<linearQuadTreeNode> nodes;
+	std::vector<int> leafNodes; // Node of every leaf, in Z-order
+
+	std::vector<uint32_t> keys;
+	std::vector<int> order; // Particle indices sorted by their keys
+	std::vector<uint32_t> keyScratch;
+	std::vector<int> orderScratch;
+
+	std::vector<int> particleLeaf; // Leaf containing the center of every particle
+	std::vector<int> ghostLeaf; // Leaf and particle of every ghost found by the last build
+	std::vector<int> ghostParticle;
+
+	std::vector<int> leafStart; // Offset of every leaf inside entries, one past the end for the last leaf
+	std::vector<int> leafCursor;
+	std::vector<int> entries; // Particles of every leaf, followed by its ghosts
+};
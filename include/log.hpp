@@ -1,13 +1,20 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <vector>
+#include <deque>
 #include <string>
 #include <chrono>
 #include <fstream>
 #include <fmt/format.h>
 #include <fmt/chrono.h>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
 #include <optional>
+#include <cstdint>
 
 enum class LogLevel
 {
@@ -21,126 +28,116 @@ struct LogEntry
 	std::string message;
 	std::string timestamp;
 	unsigned int calls;
+	uint64_t revision; // History revision of the last change of the entry
 };
 
-inline std::string currentTimeString()
+// Message on its way from the logging thread to the writer thread
+struct LogRecord
 {
-	auto now_tp = std::chrono::system_clock::now();
+	LogLevel level;
+	std::string message;
+	std::chrono::system_clock::time_point time;
+};
 
-	auto now_c = std::chrono::system_clock::to_time_t(now_tp);
+// Ring of the messages of one thread that the writer hasn't taken yet
+// Only the owner thread pushes and only the writer thread pops, so the slots themselves need no synchronization
+struct LogBuffer
+{
+	static constexpr uint64_t capacity = 4096;
+
+	LogBuffer() : head(0), tail(0), dropped(0) {}
 
-	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now_tp.time_since_epoch()) % 1000;
+	std::array<LogRecord, capacity> records;
+	alignas(64) std::atomic<uint64_t> head; // Records pushed, the next one goes to head % capacity
+	alignas(64) std::atomic<uint64_t> tail; // Records the writer took
+	std::atomic<uint64_t> dropped; // Records lost because the ring was full
+};
 
-	return fmt::format("{:%T}.{:03}", fmt::localtime(now_c), ms.count());
+inline std::string formatTime(std::chrono::system_clock::time_point time)
+{
+	auto time_c = std::chrono::system_clock::to_time_t(time);
+
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) % 1000;
+
+	return fmt::format("{:%T}.{:03}", fmt::localtime(time_c), ms.count());
+}
+
+inline std::string currentTimeString()
+{
+	return formatTime(std::chrono::system_clock::now());
 }
 
-class log 
+// Asynchronous log, info and error only format the message and push it to a ring of the calling thread
+// A writer thread collects the rings, writes them to the file in batches and keeps a bounded history
+// in which repeated errors share one entry
+class log
 {
 public:
+	static constexpr int maxThreads = 64; // Threads with a ring of their own, later threads share a locked queue
+	static constexpr size_t historyCapacity = 1000; // Entries kept in the history, the oldest ones are dropped first
 
-	static void initFile(const std::string& filename)
-    {
-        auto& instance = getInstance();
-    	std::lock_guard<std::mutex> lock(instance.mtx);
-    	instance.fileStream.emplace(filename, std::ios::out | std::ios::trunc);
-    }
+	static void initFile(const std::string& filename);
 
 	template<typename... Args>
 	static void error(const std::string& formatStr, Args&&... args)
 	{
-		std::string msg = fmt::format(fmt::runtime(formatStr), std::forward<Args>(args)...);
-		std::string now = currentTimeString();
-		auto& instance = getInstance();
-		{
-			std::lock_guard<std::mutex> lock(instance.mtx);
-			bool updated = false;
-			for (auto& entry : instance.entries)
-			{
-				if (entry.level == LogLevel::Error && entry.message == msg)
-				{
-					entry.timestamp = now;
-					entry.calls += 1;
-					updated = true;
-					break;
-				}
-			}
-			if (!updated)
-			{
-				instance.entries.push_back({LogLevel::Error, msg, now});
-			}
-
-			if(instance.fileStream && instance.fileStream->is_open())
-            {
-                *instance.fileStream << "[ERROR] " << now << " - " << msg << "\n";
-                instance.fileStream->flush();
-            }
-		}
+		push(LogLevel::Error, fmt::format(fmt::runtime(formatStr), std::forward<Args>(args)...));
 	}
 
 	template<typename... Args>
 	static void info(const std::string& formatStr, Args&&... args)
 	{
-		std::string msg = fmt::format(fmt::runtime(formatStr), std::forward<Args>(args)...);
-		std::string now = currentTimeString();
-		auto& instance = getInstance();
-		{
-			std::lock_guard<std::mutex> lock(instance.mtx);
-			instance.entries.push_back({LogLevel::Info, msg, now});
-			if(instance.fileStream && instance.fileStream->is_open())
-            {
-                *instance.fileStream << "[INFO] " << now << " - " << msg << "\n";
-                instance.fileStream->flush();
-            }
-		}
+		push(LogLevel::Info, fmt::format(fmt::runtime(formatStr), std::forward<Args>(args)...));
 	}
 
-	static void printAll()
-    {
-        auto& instance = getInstance();
-        std::vector<LogEntry> entriesCopy;
-        {
-            std::lock_guard<std::mutex> lock(instance.mtx);
-            entriesCopy = instance.entries;
-        }
-
-        std::string buffer;
-
-        buffer.append("\033[H\033[J");
-
-        for (const auto &entry : entriesCopy)
-        {
-            if (entry.level == LogLevel::Error)
-            {
-                fmt::format_to(std::back_inserter(buffer),
-                    "\033[31m[ERROR]\033[0m [{}] {} [{}]\n", entry.timestamp, entry.message, entry.calls);
-            }
-            else
-            {
-                fmt::format_to(std::back_inserter(buffer),
-                    "\033[32m[INFO]\033[0m [{}] {}\n", entry.timestamp, entry.message);
-            }
-        }
-
-        fmt::print("{}", buffer);
-
-        fflush(stdout);
-        fflush(stderr);
-    }
-	
+	// Block until the writer handled every message logged before the call
+	static void flush();
+
+	// Copy the entries of the history that were added or changed after the given revision, in the order of the history
+	// Returns the current revision, which the next call passes to only see what changed since
+	static uint64_t getChanges(uint64_t since, std::vector<LogEntry>& changed);
+
 private:
-	log() = default;
-	~log() = default;
-	
+	log();
+	~log();
+
 	log(const log&) = delete;
 	log& operator=(const log&) = delete;
-	
-	static log& getInstance()
-	{
-		static log instance;
-		return instance;
-	}
 
-	std::vector<LogEntry> entries;
-	std::mutex mtx;
+	static log& getInstance();
+
+	static void push(LogLevel level, std::string message);
+	LogBuffer* getBuffer();
+	void writerLoop();
+	void drain();
+	void addToHistory(const LogRecord& record, const std::string& timestamp);
+
+	// Rings of the logging threads, registered on their first message and kept until the process exits
+	std::array<std::atomic<LogBuffer*>, maxThreads> buffers;
+	std::atomic<int> bufferCount;
+	std::mutex overflowMutex;
+	std::vector<LogRecord> overflow;
+
+	std::thread writer;
+	std::atomic<bool> stopping;
+	std::mutex wakeMutex;
+	std::condition_variable wakeCondition;
+
+	// Flush requests, the writer completes a request once it drained every ring after the request was made
+	std::atomic<uint64_t> flushRequested;
+	uint64_t flushCompleted;
+	std::condition_variable flushCondition;
+
+	// Only used by the writer thread
+	std::vector<LogRecord> batch;
+	std::string text;
+
+	std::mutex fileMutex;
 	std::optional<std::ofstream> fileStream;
+
+	std::mutex historyMutex;
+	std::deque<LogEntry> entries;
+	uint64_t firstEntry; // Number of the oldest entry in entries, counting every entry ever added
+	uint64_t revision; // Changes of the history so far
+	std::unordered_map<size_t, uint64_t> errorEntries; // Hash of an error message to the number of its entry
 };
@@ -11,11 +11,17 @@
 #include "parser.hpp"
 #include "interface.hpp"
 #include "simulation.hpp"
+#include "simulationThread.hpp"
+#include "simulationRenderer.hpp"
+#include "allocationStats.hpp"
+#include "phaseTimers.hpp"
+#include "trace.hpp"
+#include "terminalView.hpp"
 
 class manager
 {
 public:
-	manager();
+	manager(const schedulerSettings& nSettings);
 	void loadMenus();
 	void update();
 	void render();
@@ -36,7 +42,6 @@ private:
 	std::string displayFps;
 
 	double timeStep;
-	int tickCount;
 	double tpsTimer;
 	int tps;
 	std::string displayTps;
@@ -53,9 +58,21 @@ private:
 
 	parser* p;
 	simulationContainer* container;
+	simulationThread* simulation;
+	simulationRenderer* renderer;
+	terminalView* view; // Log and status output on the console
+	bool isPlacingParticle; // Flag for the preview line of a particle being placed
+	vector2d placeParticlePosition;
 	int particleSpawnCount;
 	std::string displayParticleCount;
 	std::string displaySimulationState;
+	std::string displayBroadphase;
+	std::string displayAllocations;
+	schedulerSettings settings; // Thread placement of the simulation's scheduler
+	std::string displayThreads;
+	std::string displayEnergy;
+	std::array<std::string, size_t(timedPhase::count)> displayPhaseTimes; // min/avg/p99 of every timed phase
+	std::string displaySolveThreads;
 
 	aCamera* camera;
 	aWindow* window;
@@ -1,9 +1,5 @@
 #pragma once
 
-#include <SDL3/SDL.h>
-#include <SDL3_image/SDL_image.h>
-#include <SDL3_ttf/SDL_ttf.h>
-
 #include <cmath>
 #include <iostream>
 
@@ -19,8 +15,6 @@ double aAbs(double value);
 
 double isqrt(double target);
 
-SDL_Color interpolateColor(const SDL_Color& color1, const SDL_Color& color2, double factor);
-
 double interpolateDouble(double value1, double value2, double factor);
 
 struct vector2d
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "taskScheduler.hpp"
+
+// Spread the lower 16 bits of a value to the even bits
+inline uint32_t mortonSpread(uint32_t value)
+{
+	value &= 0x0000ffff;
+	value = (value | (value << 8)) & 0x00ff00ff;
+	value = (value | (value << 4)) & 0x0f0f0f0f;
+	value = (value | (value << 2)) & 0x33333333;
+	value = (value | (value << 1)) & 0x55555555;
+	return value;
+}
+
+// Interleave two 16 bit coordinates into a Z-order key, x takes the even bits
+inline uint32_t mortonEncode(uint32_t x, uint32_t y)
+{
+	return mortonSpread(x) | (mortonSpread(y) << 1);
+}
+
+// Z-order key of a position inside the square [-halfDimension, halfDimension]
+uint32_t mortonKey(double x, double y, double halfDimension);
+
+// Sort values by their keys in ascending order, keeping equal keys in their original order
+// The scratch vectors are only used as temporary storage and keep their capacity between calls
+void radixSort(std::vector<uint32_t>& keys, std::vector<int>& values, std::vector<uint32_t>& keyScratch, std::vector<int>& valueScratch);
+
+// Same as radixSort, with every pass split into chunks that are counted and scattered on the scheduler
+// Falls back to radixSort for small inputs
+void parallelRadixSort(std::vector<uint32_t>& keys, std::vector<int>& values, std::vector<uint32_t>& keyScratch, std::vector<int>& valueScratch, taskScheduler* scheduler, int chunkCount);
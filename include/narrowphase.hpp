@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+#include "math.hpp"
+#include "particleStore.hpp"
+
+// Instruction sets the narrow phase can use, in ascending order
+enum class simdLevel
+{
+	scalar,
+	sse42,
+	avx2
+};
+
+// Best instruction set supported by the running CPU
+simdLevel detectSimdLevel();
+std::string getSimdLevelName(simdLevel level);
+
+// Find the first candidate in [first, last) whose bounds touch the bounds of a particle at position with radius,
+// returns last if there is none
+// Every level makes exactly the decisions of the scalar bounds test in collide, so results are bit-identical
+int nextContact(simdLevel level, const particleStore& store, vector2d position, double radius, const int* candidates, int first, int last);
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "taskScheduler.hpp"
+
+// How parallelFor and parallelReduce split a range of items into chunks of similar estimated cost
+// staticChunks - one chunk per thread, handed out up front
+// dynamic - eight chunks per thread, claimed by the threads in order
+// guided - chunks shrinking with the remaining cost, claimed by the threads in order
+enum class partitionMode
+{
+	staticChunks,
+	dynamic,
+	guided
+};
+
+// Upper bound of chunks per loop, which lets the chunk boundaries and partial results live on the stack
+static constexpr int maxParallelChunks = 256;
+
+// Chunk boundaries of a range, chunk k covers the items [bounds[k], bounds[k + 1])
+struct parallelChunks
+{
+	std::array<size_t, maxParallelChunks + 1> bounds;
+	int count;
+};
+
+// Split the items [0, count) into chunks by the cost estimate of every item
+// Every item costs at least one unit, which stands for its share of the scheduling overhead
+template<class Cost>
+void planChunks(parallelChunks& chunks, partitionMode mode, int threads, size_t count, Cost& cost)
+{
+	double total = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		total += double(cost(i)) + 1;
+	}
+
+	int target = threads;
+	if (mode == partitionMode::dynamic)
+		target = threads * 8;
+	target = std::clamp(target, 1, maxParallelChunks);
+
+	// Guided chunks take a share of the remaining cost, but never less than a minimum grain
+	double grain = total / target;
+	double minGrain = total / (maxParallelChunks / 2);
+	double remaining = total;
+
+	chunks.count = 0;
+	chunks.bounds[0] = 0;
+	double chunkCost = 0;
+	double chunkTarget = (mode == partitionMode::guided) ? std::max(remaining / (2 * threads), minGrain) : grain;
+	for (size_t i = 0; i < count; ++i)
+	{
+		chunkCost += double(cost(i)) + 1;
+		if (chunkCost < chunkTarget || i + 1 == count || chunks.count + 2 >= maxParallelChunks)
+			continue;
+
+		chunks.count++;
+		chunks.bounds[chunks.count] = i + 1;
+		remaining -= chunkCost;
+		chunkCost = 0;
+		if (mode == partitionMode::guided)
+			chunkTarget = std::max(remaining / (2 * threads), minGrain);
+	}
+
+	if (count > 0)
+	{
+		chunks.count++;
+		chunks.bounds[chunks.count] = count;
+	}
+}
+
+// Run chunk(k) for every chunk k on the scheduler, and return once all finished
+// Static chunks are submitted one by one, dynamic and guided chunks are claimed in order by one task per thread
+template<class Chunk>
+void runChunks(taskScheduler& scheduler, partitionMode mode, int threads, int chunkCount, Chunk& chunk)
+{
+	taskGroup group;
+	if (mode == partitionMode::staticChunks)
+	{
+		auto run = [&chunk](size_t begin, size_t) { chunk(int(begin)); };
+		for (int k = 0; k < chunkCount; ++k)
+		{
+			scheduler.submit(group, run, k, k + 1);
+		}
+		scheduler.wait(group);
+		return;
+	}
+
+	std::atomic<int> next(0);
+	auto claim = [&chunk, &next, chunkCount](size_t, size_t)
+	{
+		for (int k = next.fetch_add(1, std::memory_order_relaxed); k < chunkCount; k = next.fetch_add(1, std::memory_order_relaxed))
+		{
+			chunk(k);
+		}
+	};
+	for (int t = 0; t < std::min(threads, chunkCount); ++t)
+	{
+		scheduler.submit(group, claim, t, t + 1);
+	}
+	scheduler.wait(group);
+}
+
+// Call body(begin, end) on chunks of the items [0, count) in parallel
+// cost(i) estimates the work of item i, chunks are formed so that their summed costs are similar
+template<class Cost, class Body>
+void parallelFor(taskScheduler& scheduler, partitionMode mode, size_t count, Cost cost, Body body)
+{
+	if (count == 0)
+		return;
+
+	// The waiting thread runs chunks as well
+	int threads = scheduler.getThreadCount() + 1;
+
+	parallelChunks chunks;
+	planChunks(chunks, mode, threads, count, cost);
+
+	auto chunk = [&](int k) { body(chunks.bounds[k], chunks.bounds[k + 1]); };
+	runChunks(scheduler, mode, threads, chunks.count, chunk);
+}
+
+// Reduce the items [0, count) in parallel, body(begin, end) returns the result of a chunk
+// Chunk results are combined in chunk order, so the result only depends on the chunk boundaries
+template<class T, class Cost, class Body, class Combine>
+T parallelReduce(taskScheduler& scheduler, partitionMode mode, size_t count, T identity, Cost cost, Body body, Combine combine)
+{
+	if (count == 0)
+		return identity;
+
+	int threads = scheduler.getThreadCount() + 1;
+
+	parallelChunks chunks;
+	planChunks(chunks, mode, threads, count, cost);
+
+	std::array<T, maxParallelChunks> partials;
+	auto chunk = [&](int k) { partials[k] = body(chunks.bounds[k], chunks.bounds[k + 1]); };
+	runChunks(scheduler, mode, threads, chunks.count, chunk);
+
+	T result = identity;
+	for (int k = 0; k < chunks.count; ++k)
+	{
+		result = combine(result, partials[k]);
+	}
+	return result;
+}
+
+// Return how many of the items [0, count) satisfy keep(i), and if that isn't all of them, write their indices in increasing order to kept
+// Every chunk counts its kept items, and after a prefix sum over the chunks writes them to its own range of kept
+template<class Keep>
+size_t parallelCompact(taskScheduler& scheduler, size_t count, Keep keep, std::vector<int>& kept)
+{
+	if (count == 0)
+		return 0;
+
+	int threads = scheduler.getThreadCount() + 1;
+
+	parallelChunks chunks;
+	auto cost = [](size_t) { return 0; };
+	planChunks(chunks, partitionMode::staticChunks, threads, count, cost);
+
+	std::array<size_t, maxParallelChunks + 1> offsets;
+	auto countChunk = [&](int k)
+	{
+		size_t chunkKept = 0;
+		for (size_t i = chunks.bounds[k]; i < chunks.bounds[k + 1]; ++i)
+		{
+			if (keep(i))
+				chunkKept++;
+		}
+		offsets[k + 1] = chunkKept;
+	};
+	runChunks(scheduler, partitionMode::staticChunks, threads, chunks.count, countChunk);
+
+	offsets[0] = 0;
+	for (int k = 0; k < chunks.count; ++k)
+	{
+		offsets[k + 1] += offsets[k];
+	}
+	if (offsets[chunks.count] == count)
+		return count;
+
+	kept.resize(offsets[chunks.count]);
+
+	auto writeChunk = [&](int k)
+	{
+		size_t next = offsets[k];
+		for (size_t i = chunks.bounds[k]; i < chunks.bounds[k + 1]; ++i)
+		{
+			if (keep(i))
+				kept[next++] = int(i);
+		}
+	};
+	runChunks(scheduler, partitionMode::staticChunks, threads, chunks.count, writeChunk);
+
+	return offsets[chunks.count];
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+
+#include "math.hpp"
+
+class taskScheduler;
+
+// Contiguous structure-of-arrays storage of all simulated particles,
+// every column is indexed by the particle index
+struct particleStore
+{
+	particleStore();
+	particleStore(const particleStore& other);
+	particleStore& operator=(const particleStore& other);
+	particleStore(particleStore&& other) = default;
+	particleStore& operator=(particleStore&& other) = default;
+
+	int add(vector2d position, double radius, double density);
+	void erase(int index);
+	void clear();
+	void reserve(int count);
+	void reorder(const std::vector<int>& order, taskScheduler* scheduler = nullptr);
+
+	inline int getCount() {return int(x.size());}
+
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> vx;
+	std::vector<double> vy;
+	std::vector<double> ax;
+	std::vector<double> ay;
+	std::vector<double> radius;
+	std::vector<double> inverseMass;
+
+	static constexpr int slabSize = 4096; // Minimum number of particles the columns grow by
+
+	std::vector<double> scratch; // Temporary column used while reordering and compacting
+
+	int layoutVersion; // Changes whenever existing particles are removed or moved to other indices
+
+private:
+	void copyColumns(const particleStore& other);
+
+	// Particles every column has room for, the columns grow together once it is reached
+	// The columns are swapped with scratch while reordering, so their own capacities may differ and are never compared
+	int capacity;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+// Phases of a tick and of a frame that are timed for the debug menu
+// rebuild covers the whole broadphase build, split only the restructuring of the quadtree inside it
+enum class timedPhase
+{
+	integrate,
+	rebuild,
+	split,
+	solve,
+	events,
+	renderGrid,
+	renderParticles,
+	renderBroadphase,
+	renderMenus,
+	display,
+	count
+};
+
+// Rolling window of the last durations of a phase, in milliseconds
+struct phaseHistory
+{
+	static constexpr int capacity = 256;
+
+	phaseHistory() : next(0), size(0) {}
+
+	void add(double milliseconds);
+
+	// Minimum, average and 99th percentile of the window, all zero while it is empty
+	void summarize(double& min, double& average, double& p99);
+
+	std::mutex mtx;
+	std::array<float, capacity> samples;
+	int next;
+	int size;
+};
+
+// Process wide timers of the hot paths, read by the debug menu
+// The scoped timers only exist when built with PARTICLES_PHASE_TIMERS, otherwise the macros below compile to nothing
+struct phaseTimers
+{
+	static constexpr int maxThreads = 64;
+
+	static void record(timedPhase phase, double milliseconds);
+
+	// Add time the calling thread spent solving leaves to its share of the current tick
+	static void addThreadTime(double milliseconds);
+
+	// Move the shares of the threads into their histories, called once the solve of a tick finished
+	static void finishTick();
+
+	// "name: min/avg/p99" of a phase in milliseconds
+	static std::string getSummary(timedPhase phase);
+
+	// Average solve time of every thread that solved leaves recently
+	static std::string getThreadSummary();
+
+	static const char* getName(timedPhase phase);
+	static bool enabled();
+
+	static std::array<phaseHistory, size_t(timedPhase::count)> histories;
+	static std::array<phaseHistory, maxThreads> threadHistories;
+	static std::array<std::atomic<long long>, maxThreads> threadTime; // Nanoseconds solved in the current tick
+	static std::atomic<int> threadCount; // Threads that were given an index
+
+private:
+	static int getThreadIndex();
+};
+
+#ifdef PARTICLES_PHASE_TIMERS
+
+// Records the lifetime of its scope as a sample of a phase, unless it was created inactive
+class scopedPhaseTimer
+{
+public:
+	scopedPhaseTimer(timedPhase nPhase, bool nActive = true) : phase(nPhase), active(nActive), start(std::chrono::steady_clock::now()) {}
+	~scopedPhaseTimer()
+	{
+		if (active)
+			phaseTimers::record(phase, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+private:
+	timedPhase phase;
+	bool active;
+	std::chrono::steady_clock::time_point start;
+};
+
+// Adds the lifetime of its scope to the solve time of the calling thread
+class scopedThreadTimer
+{
+public:
+	scopedThreadTimer() : start(std::chrono::steady_clock::now()) {}
+	~scopedThreadTimer() {phaseTimers::addThreadTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());}
+
+private:
+	std::chrono::steady_clock::time_point start;
+};
+
+#define PHASE_TIMER_JOIN(a, b) a##b
+#define PHASE_TIMER_NAME(line) PHASE_TIMER_JOIN(phaseTimer, line)
+#define TIME_PHASE(phase) scopedPhaseTimer PHASE_TIMER_NAME(__LINE__)(phase)
+#define TIME_PHASE_IF(condition, phase) scopedPhaseTimer PHASE_TIMER_NAME(__LINE__)(phase, condition)
+#define TIME_THREAD_SOLVE() scopedThreadTimer PHASE_TIMER_NAME(__LINE__)
+
+#else
+
+#define TIME_PHASE(phase)
+#define TIME_PHASE_IF(condition, phase)
+#define TIME_THREAD_SOLVE()
+
+#endif
@@ -1,41 +1,111 @@
 #pragma once
 
 #include <vector>
-#include <deque>
 #include <string>
 
 #include "math.hpp"
-#include "utility.hpp"
-#include "aCamera.hpp"
-#include "simulationElements.hpp"
+#include "particleStore.hpp"
 
 struct quadTreeBox
 {
 	quadTreeBox();
 	quadTreeBox(vector2d center, double halfDimension);
 
+	// Check if a point lies inside the box, the lower edges are inclusive and the upper exclusive
+	inline bool contains(vector2d point)
+	{
+		return point.x >= center.x - halfDimension &&
+			point.x < center.x + halfDimension &&
+			point.y >= center.y - halfDimension &&
+			point.y < center.y + halfDimension;
+	}
+
+	// Check if another box lies strictly inside, without touching any of the edges
+	inline bool covers(quadTreeBox box)
+	{
+		return box.center.x - box.halfDimension > center.x - halfDimension &&
+			box.center.x + box.halfDimension < center.x + halfDimension &&
+			box.center.y - box.halfDimension > center.y - halfDimension &&
+			box.center.y + box.halfDimension < center.y + halfDimension;
+	}
+
+	// Check if another box touches or overlaps this one
+	inline bool overlaps(quadTreeBox box)
+	{
+		return box.center.x - box.halfDimension <= center.x + halfDimension &&
+			box.center.x + box.halfDimension >= center.x - halfDimension &&
+			box.center.y - box.halfDimension <= center.y + halfDimension &&
+			box.center.y + box.halfDimension >= center.y - halfDimension;
+	}
+
 	vector2d center;
 	double halfDimension;
 };
 
+struct quadTree;
+class quadTreePool;
+
+// Leaf holding the center of every particle and the particle's slot inside that leaf
+struct quadTreeHomes
+{
+	std::vector<quadTree*> leaf;
+	std::vector<int> slot;
+};
+
+// Persistent quadtree, particles are stored in the leaf containing their center
+// and as ghosts in every other leaf their expanded bounds overlap
 struct quadTree
 {
 
-	quadTree(quadTreeBox nBoundary, int nCapacity);
+	quadTree(quadTreeBox nBoundary, int nCapacity, quadTree* nParent);
+
+	// Get the child quadrant a point falls into
+	inline quadTree* getChild(vector2d point)
+	{
+		if (point.x >= boundary.center.x)
+			return (point.y >= boundary.center.y) ? se : ne;
 
-	void split();
-	void render(aCamera* camera, vector2d mouse);
-	void insertParticle(particle* p);
-	void clear();
+		return (point.y >= boundary.center.y) ? sw : nw;
+	}
+
+	void split(particleStore& store, quadTreeHomes& homes, quadTreePool& pool);
+	void merge(quadTreeHomes& homes, quadTreePool& pool);
+	void restructure(particleStore& store, quadTreeHomes& homes, quadTreePool& pool);
+	void insertParticle(int index, vector2d position, quadTreeHomes& homes);
+	void removeParticle(int index, quadTreeHomes& homes);
+	void insertGhost(int index, quadTreeBox bounds, quadTree* home);
 	void getLeaves(std::vector<quadTree*>& quads);
 
 	quadTreeBox boundary;
 	const int capacity;
-	std::deque<particle*> particles;
+	std::vector<int> particles; // Particles centered in this leaf, followed by the ghosts
+	int homeCount;
 
+	quadTree* parent;
 	quadTree* nw;
 	quadTree* ne;
 	quadTree* sw;
 	quadTree* se;
 
+};
+
+// Allocates quadTree nodes in blocks and recycles released nodes through a free list
+// Recycled nodes keep their particle buffers, so a warmed up tree stops touching the heap
+class quadTreePool
+{
+public:
+	quadTreePool(int nCapacity);
+
+	quadTree* acquire(quadTreeBox boundary, quadTree* parent);
+	void release(quadTree* node);
+	void reset();
+
+private:
+	static constexpr int blockSize = 256;
+
+	int capacity;
+	std::vector<std::vector<quadTree>> blocks;
+	int blockIndex; // Block handing out fresh nodes
+	int blockUsed; // Nodes of that block handed out since the last reset
+	std::vector<quadTree*> freeNodes;
 };
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "broadphase.hpp"
+#include "quadTree.hpp"
+
+// Broadphase backed by a persistent quadTree
+// Only particles whose center left their leaf are moved, leaves split and merge lazily
+class quadTreeBroadphase : public broadphase
+{
+public:
+	quadTreeBroadphase(double nHalfDimension, int nCapacity);
+	~quadTreeBroadphase();
+
+	void build(particleStore& store) override;
+	void getLeaves(std::vector<broadphaseLeaf>& leaves) override;
+	void clear() override;
+	std::string getName() override;
+
+private:
+	void reset();
+
+	double halfDimension;
+	int capacity;
+
+	quadTreePool pool;
+	quadTree* root;
+	std::vector<quadTree*> quads;
+
+	quadTreeHomes homes;
+	int trackedCount; // Number of particles already inserted into the tree
+	int trackedLayout; // Layout version of the store the tracked indices refer to
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "particleStore.hpp"
+#include "broadphase.hpp"
+
+class simulationContainer;
+
+// Initial state and run length of a batch simulation, read from a scenario file
+// The file uses the key{value} syntax of the menus, inside a scenario{} block:
+// ticks{count} - ticks to run
+// seed{value} - random seed of the generators following it
+// broadphase{name} - quadTree, linearQuadTree or cellGrid
+// iterationSteps{count} - collision passes per tick
+// grid{count, radius, spacing} - particles on a jittered square grid around the origin
+// cluster{x, y, count, radius, spread} - normally distributed clump of particles
+// particle{x, y, radius, vx, vy} - a single particle with a velocity
+struct scenario
+{
+	scenario();
+
+	bool load(const std::string& filePath);
+
+	// Add the particles to a simulation and apply the settings
+	void apply(simulationContainer& container);
+
+	int ticks;
+	int iterationSteps; // 0 keeps the simulation's default
+	broadphaseType broadphase;
+	particleStore particles;
+};
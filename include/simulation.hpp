@@ -10,40 +10,143 @@
 #include <memory>
 #include <unordered_map>
 
-#include "ThreadPool.h"
+#include "taskScheduler.hpp"
+#include "taskGraph.hpp"
+#include "parallel.hpp"
+#include "tripleBuffer.hpp"
 
 #include "math.hpp"
-#include "utility.hpp"
-#include "aCamera.hpp"
+#include "particleStore.hpp"
 #include "simulationElements.hpp"
 #include "quadTree.hpp"
+#include "broadphase.hpp"
+#include "morton.hpp"
+#include "narrowphase.hpp"
+
+// How leaves are distributed over the scheduler
+// unordered - all leaves at once, particles shared by neighbouring leaves are written concurrently
+// colored - leaves sharing a particle get different colors, and colors are solved one after another
+enum class solverMode
+{
+	unordered,
+	colored
+};
+
+// How a tick is run on the scheduler
+// forkJoin - every pass is a parallel loop of its own, whose tasks the workers have to pick up
+// phased - the whole tick is one region, with the threads spinning on a barrier between the passes
+// graph - the passes are nodes of a task graph, every pass depends on the one before, so besides the statistics
+//         overlapping the snapshot the graph runs the passes in the order of forkJoin, each a parallel loop of its own
+enum class executionMode
+{
+	forkJoin,
+	phased,
+	graph
+};
 
-
+// Statistics of the state at the end of the last tick
+struct simulationStats
+{
+	double kineticEnergy;
+	double maxSpeed;
+	int leafCount;
+	long long pairTests; // Candidate pairs the narrow phase tested during the tick
+};
+
+// Immutable copy of the simulation state published after every tick, which the render thread draws from
+struct particleSnapshot
+{
+	particleSnapshot() : stats{0, 0, 0, 0}, running(false), publishTime(0), tickInterval(0) {}
+
+	std::vector<double> x;
+	std::vector<double> y;
+	std::vector<double> previousX; // Position one tick earlier, the current one for particles that were added or moved to other indices
+	std::vector<double> previousY;
+	std::vector<double> vx;
+	std::vector<double> vy;
+	std::vector<double> radius;
+
+	std::vector<quadTreeBox> leafBoxes; // Boundaries of the broadphase leaves, for the debug overlay
+	std::vector<int> selectedParticles;
+	std::string broadphaseName;
+	std::string schedulerName; // Workers of the simulation's scheduler and their placement
+	simulationStats stats;
+	bool running;
+
+	double publishTime; // Seconds on the steady clock when the snapshot was published
+	double tickInterval; // Seconds between the ticks of previousX and x
+};
 
 class simulationContainer
 {
 	public:
-		simulationContainer();
+		simulationContainer(const schedulerSettings& settings = schedulerSettings());
 		void cleanUp();
 
 		void update();
-		void render(aCamera *camera);
-		void select(aCamera* camera);
-		void renderQuadTree(aCamera *camera, vector2d mouse);
+		void solveCollisions();
+		void solveLeaf(const broadphaseLeaf& leaf);
+		void publishSnapshot();
+
+		bool acquireSnapshot();
+		const particleSnapshot& getSnapshot();
+
+		void select(vector2d position);
 		void placeParticle(vector2d position, double radius, bool state);
 		
 		void addStaticPoint(vector2d position);
 		void addStaticLine(int a, int b);
+		const std::vector<staticLine>& getStaticLines();
 
 		void switchRunning();
 		bool getRunning();
 
+		void setSchedulerSettings(const schedulerSettings& settings);
+		std::string getSchedulerName();
+
+		// Scheduler of the simulation, only the thread ticking the simulation submits to it
+		taskScheduler* getScheduler();
+		void setExecutionMode(executionMode mode);
+		void setIterationSteps(int steps);
+		void setReordering(bool enabled);
+		void setSolverMode(solverMode mode);
+		void setPartitionMode(partitionMode mode);
+		void setHalfPairs(bool enabled);
+		void setSimdLevel(simdLevel level);
+		std::string getSimdLevelName();
+
+		void setBroadphase(broadphaseType type);
+		void switchBroadphase();
+		std::string getBroadphaseName();
+
+		simulationStats getStats();
+
 		void addParticle(vector2d position, double radius);
-		particle* getParticle(int id);
+		particle getParticle(int id);
 		int getParticleCount();
 
 	private:
-		void worker(quadTree* q);
+		void updatePhases();
+		void updateGraph();
+		void buildFrameGraph();
+		void captureSnapshot(particleSnapshot& target);
+		void updateStats();
+		void integrate();
+		void integrateRange(size_t begin, size_t end);
+		void removeOutOfBounds();
+		void removeOutOfBoundsPhase(phaseContext& phase);
+		bool isInBounds(size_t p);
+		void prepareLeaves();
+		void solvePreparedLeaves();
+		void solvePhases(phaseContext& phase);
+		void worker(const broadphaseLeaf& leaf);
+		void halfPairWorker(const broadphaseLeaf& leaf);
+		void orderedPairWorker(const broadphaseLeaf& leaf);
+		void collide(vector2d& positionA, vector2d& velocityA, double radiusA, double inverseMassA, int b);
+		void solveLeaves(std::vector<broadphaseLeaf>& batchLeaves, size_t first, size_t last);
+		void colorLeaves();
+		double getDisorder();
+		void reorderParticles();
 
 		bool isPlacingParticle; 
 		vector2d placeParticlePosition; 
@@ -53,15 +156,51 @@ class simulationContainer
 		int quadrantCapacity; 
 		int particleCount; 
 
-		std::vector<particle*> particles;
+		particleStore particles;
 		std::vector<staticPoint> staticPoints;
 		std::vector<staticLine> staticLines;
 
-		ThreadPool* pool; 
+		taskScheduler* scheduler; 
 
 		double nodeHalfDimension; 
-		quadTree* nodeQuadTree; 
-		quadTree* selectedQuadTree;
+		double cellSize; 
+		broadphaseType nodeBroadphaseType; 
+		broadphase* nodeBroadphase; 
+		std::vector<broadphaseLeaf> leaves; 
+
+		executionMode execution; 
+		taskGraph frameGraph; 
+		int frameGraphSteps; 
+		tripleBuffer<particleSnapshot> snapshots; 
+		std::vector<double> previousX; 
+		std::vector<double> previousY; 
+		int previousLayoutVersion; 
+		double lastTickTime; 
+		simulationStats stats; 
+		long long tickPairTests; 
+		std::vector<size_t> phaseCounts; 
+		std::vector<int> phaseCursors; 
+		solverMode solver; 
+		partitionMode partition; 
+		bool halfPairs; 
+		simdLevel supportedSimdLevel; 
+		simdLevel narrowphaseLevel; 
+		std::vector<uint64_t> particleColors; 
+		std::vector<int> leafColors; 
+		std::vector<int> colorStart; 
+		std::vector<int> colorCursor; 
+		std::vector<broadphaseLeaf> coloredLeaves; 
+		std::vector<int> selectedParticles; 
+		std::vector<int> keptParticles; 
+
+		bool reordering; 
+		int reorderInterval; 
+		double reorderThreshold; 
+		int ticksSinceReorder; 
+		std::vector<uint32_t> mortonKeys; 
+		std::vector<int> mortonOrder; 
+		std::vector<uint32_t> mortonKeyScratch; 
+		std::vector<int> mortonOrderScratch; 
 
 		double density; 
 		double restitution; 
@@ -6,38 +6,31 @@
 #include <shared_mutex>
 
 #include "math.hpp"
-#include "utility.hpp"
-#include "aCamera.hpp"
+#include "particleStore.hpp"
 
+// Thin view of a single particle inside a particleStore
 class particle
 {
 public:
 
-	particle();
-	particle(vector2d nPosition, double nRadius);
+	particle(particleStore* nStore, int nIndex);
 
-	void render(aCamera *camera);
-	void renderDebug(aCamera *camera);
-	
-	inline double getArea() {return 3.14159265359 * radius * radius;}
+	inline double getArea() {return 3.14159265359 * getRadius() * getRadius();}
 
-	inline void setPosition(vector2d nPosition) {position = nPosition;}
-	inline void setVelocity(vector2d nVelocity) {velocity = nVelocity;}
-	inline void setAcceleration(vector2d nAcceleration) {acceleration = nAcceleration;}
-	inline void setRadius(double nRadius) {radius = nRadius;}
+	inline void setPosition(vector2d nPosition) {store->x[index] = nPosition.x; store->y[index] = nPosition.y;}
+	inline void setVelocity(vector2d nVelocity) {store->vx[index] = nVelocity.x; store->vy[index] = nVelocity.y;}
+	inline void setAcceleration(vector2d nAcceleration) {store->ax[index] = nAcceleration.x; store->ay[index] = nAcceleration.y;}
 
-	inline vector2d getPosition() {return position;}
-	inline vector2d getVelocity() {return velocity;}
-	inline vector2d getAcceleration() {return acceleration;}
-	inline double getRadius() {return radius;}
+	inline vector2d getPosition() {return {store->x[index], store->y[index]};}
+	inline vector2d getVelocity() {return {store->vx[index], store->vy[index]};}
+	inline vector2d getAcceleration() {return {store->ax[index], store->ay[index]};}
+	inline double getRadius() {return store->radius[index];}
+	inline int getIndex() {return index;}
 
 private:
 
-	vector2d position;
-	vector2d velocity;
-	vector2d acceleration;
-
-	double radius;
+	particleStore* store;
+	int index;
 };
 
 struct staticPoint
@@ -49,8 +42,6 @@ struct staticPoint
 struct staticLine
 {
 	staticLine(staticPoint *na, staticPoint *nb);
-	void render(aCamera *camera);
-	void renderNormal(aCamera *camera);
 	vector2d getNormal();
 	
 	staticPoint* a;
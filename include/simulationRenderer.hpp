@@ -0,0 +1,40 @@
+#pragma once
+
+#include "math.hpp"
+#include "aCamera.hpp"
+#include "discBatch.hpp"
+#include "simulation.hpp"
+#include "taskScheduler.hpp"
+
+// Color of a particle moving at the given speed, fading from white to red
+SDL_Color getSpeedColor(double speed);
+
+// Render the outline of a broadphase leaf, highlighted when hovered by the mouse
+void renderBox(aCamera* camera, quadTreeBox box, vector2d mouse);
+
+// Draws the snapshots of a simulationContainer through a camera
+// The simulation itself knows nothing about SDL, everything it shows on screen goes through here
+// The quads of the particles are written by a small scheduler of its own, so waiting for them never runs simulation tasks
+// and the simulation may replace its scheduler at any time
+class simulationRenderer
+{
+public:
+	static constexpr int maxWorkers = 3; // Workers of the render scheduler at most, writing the quads is cheap next to a tick
+
+	// The settings place the render workers, their thread count is capped at maxWorkers
+	simulationRenderer(simulationContainer* nContainer, const schedulerSettings& nSettings = schedulerSettings());
+	~simulationRenderer();
+
+	// Write the particles of the current snapshot to the disc batch in parallel, at a fraction alpha of the way
+	// from their previous to their current positions, using the transform the batch was begun with
+	void prepareDiscs(double alpha);
+	void render(aCamera *camera, double alpha);
+	void renderBroadphase(aCamera *camera, vector2d mouse);
+
+	discBatch& getDiscs();
+
+private:
+	simulationContainer* container;
+	taskScheduler* scheduler;
+	discBatch discs; // Particles of the frame, drawn at once
+};
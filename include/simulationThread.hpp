@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "simulation.hpp"
+
+// Runs the ticks of a simulation on a thread of its own at a fixed time step
+// Other threads change the simulation only through posted commands, and read it only through its published snapshots
+class simulationThread
+{
+public:
+	simulationThread(simulationContainer* nContainer, double nTimeStep);
+
+	// Start ticking, restricted to the given cores unless there are none
+	void start(const std::vector<int>& cores = {});
+	void stop();
+
+	// Queue a change of the simulation, commands run on the simulation thread in order before its next tick
+	void post(std::function<void(simulationContainer&)> command);
+
+	// Ticks and their heap allocations since the last call
+	int takeTickCount();
+	long long takeTickAllocations();
+
+private:
+	static constexpr int maxCatchUpTicks = 4; // Ticks run back to back at most when the simulation fell behind
+
+	void loop();
+	bool runCommands();
+
+	simulationContainer* container;
+	double timeStep;
+
+	std::thread thread;
+	std::atomic<bool> stopping;
+
+	std::mutex commandMutex;
+	std::condition_variable commandCondition;
+	std::vector<std::function<void(simulationContainer&)>> commands; // Posted commands, guarded by commandMutex
+	std::vector<std::function<void(simulationContainer&)>> runningCommands; // Commands taken over by the simulation thread
+
+	std::atomic<int> tickCount;
+	std::atomic<long long> tickAllocations;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "taskScheduler.hpp"
+
+// Graph of work declared once and run many times on a taskScheduler
+// A node starts as soon as every node it depends on finished, so independent nodes overlap
+// Nodes may run parallel loops of their own, the scheduler's wait helps with them
+class taskGraph
+{
+public:
+	taskGraph();
+
+	// Add a node and return its id, nodes are kept until the graph is cleared
+	int addNode(const std::string& name, std::function<void()> work);
+
+	// Let the node after start only once the node before finished
+	void addDependency(int before, int after);
+
+	void clear();
+
+	// Run every node once and return when all finished
+	void run(taskScheduler& scheduler);
+
+	int getNodeCount();
+	const std::string& getNodeName(int node);
+
+private:
+	struct node
+	{
+		std::string name;
+		std::function<void()> work;
+		std::vector<int> successors;
+		int dependencies;
+	};
+
+	// Task running a node and submitting the successors it was the last dependency of
+	struct nodeTask
+	{
+		void operator()(size_t begin, size_t end);
+
+		taskGraph* graph;
+		taskScheduler* scheduler;
+		taskGroup* group;
+	};
+
+	std::vector<node> nodes;
+	std::vector<int> pending; // Unfinished dependencies of every node during a run
+};
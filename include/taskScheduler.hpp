@@ -0,0 +1,231 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+
+// How a taskScheduler places its threads on the cores of the host
+// threadCount - worker threads, 0 picks one per available core besides the thread waiting for the tasks
+// pinning - bind every worker to a core of its own
+// reserveMainCore - bind the constructing thread to the first available core and keep the workers off it
+struct schedulerSettings
+{
+	schedulerSettings(int nThreadCount = 0, bool nPinning = false, bool nReserveMainCore = false)
+	: threadCount(nThreadCount), pinning(nPinning), reserveMainCore(nReserveMainCore) {}
+
+	int threadCount;
+	bool pinning;
+	bool reserveMainCore;
+};
+
+// Fork-join handle, counts the submitted tasks that haven't finished yet
+struct taskGroup
+{
+	taskGroup() : pending(0) {}
+
+	std::atomic<int> pending;
+};
+
+// A range of work, the function and its context are owned by the submitter until the group was waited for
+struct task
+{
+	void (*run)(void* context, size_t begin, size_t end);
+	void* context;
+	size_t begin;
+	size_t end;
+	taskGroup* group;
+};
+
+// Slot of a taskDeque, a thief may read a slot while the owner reuses it, so every field is atomic
+// A thief only keeps what it read after winning the slot, which makes relaxed accesses sufficient
+struct taskSlot
+{
+	void store(const task& t);
+	void load(task& t);
+
+	std::atomic<void (*)(void*, size_t, size_t)> run;
+	std::atomic<void*> context;
+	std::atomic<size_t> begin;
+	std::atomic<size_t> end;
+	std::atomic<taskGroup*> group;
+};
+
+// Fixed size Chase-Lev deque, the owner pushes and pops at the bottom while thieves steal from the top
+struct taskDeque
+{
+	static constexpr int64_t capacity = 4096;
+
+	bool push(const task& t);
+	bool pop(task& t);
+	bool steal(task& t);
+
+	alignas(64) std::atomic<int64_t> top{0};
+	alignas(64) std::atomic<int64_t> bottom{0};
+	alignas(64) taskSlot slots[capacity];
+};
+
+// Sense-reversing barrier separating the phases of taskScheduler::runPhases
+// Waiting threads spin briefly, then yield, and finally sleep until the last thread arrived
+struct phaseBarrier
+{
+	phaseBarrier(int nParticipants) : participants(nParticipants), waiting(nParticipants), sense(false), sleepers(0) {}
+
+	// Block until every participant arrived, localSense is the calling thread's own copy of the sense
+	void arrive(bool& localSense);
+
+	int participants;
+	alignas(64) std::atomic<int> waiting;
+	alignas(64) std::atomic<bool> sense;
+	std::atomic<int> sleepers;
+};
+
+// A thread's view of a phased region, thread 0 is the thread that called runPhases
+struct phaseContext
+{
+	phaseContext(int nThread, int nThreadCount, phaseBarrier* nBarrier) : thread(nThread), threadCount(nThreadCount), barrier(nBarrier), sense(false) {}
+
+	// Wait until every thread of the region finished the current phase
+	inline void sync() {barrier->arrive(sense);}
+
+	// Even share of the items [0, count) of this thread
+	inline void split(size_t count, size_t& begin, size_t& end)
+	{
+		begin = count * thread / threadCount;
+		end = count * (thread + 1) / threadCount;
+	}
+
+	int thread;
+	int threadCount;
+	phaseBarrier* barrier;
+	bool sense;
+};
+
+// Phased region run by every worker and the calling thread at once
+struct phaseRegion
+{
+	void (*run)(void* context, phaseContext& phase);
+	void* context;
+	phaseBarrier* barrier;
+	std::atomic<int> remaining; // Workers that haven't finished the region yet
+};
+
+// Owners of the deques a taskScheduler reserves for threads outside its pool
+// Shared with the threads holding one, so a thread that exits after the scheduler was destroyed can still give its deque back
+struct externalSlotTable
+{
+	static constexpr int capacity = 4;
+
+	externalSlotTable() : closed(false)
+	{
+		for (auto& slot : taken)
+		{
+			slot.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	std::array<std::atomic<bool>, capacity> taken;
+	std::atomic<bool> closed; // Set once the scheduler was destroyed
+};
+
+// Work-stealing scheduler, every worker owns a deque and steals from the others when it runs dry
+// Threads outside the pool get a deque of their own on their first submit, and help running tasks while they wait
+// They hold it until they exit, while all external deques are held their tasks run right away on the submitting thread
+// Submitting never allocates, tasks that don't fit into a full deque run right away on the submitting thread
+class taskScheduler
+{
+public:
+	taskScheduler(int nThreadCount);
+	taskScheduler(const schedulerSettings& nSettings);
+	~taskScheduler();
+
+	// Run function(begin, end) on the pool as part of the group, the function must outlive the wait for the group
+	template<class F>
+	void submit(taskGroup& group, F& function, size_t begin, size_t end)
+	{
+		task t;
+		t.run = [](void* context, size_t taskBegin, size_t taskEnd) { (*static_cast<F*>(context))(taskBegin, taskEnd); };
+		t.context = &function;
+		t.begin = begin;
+		t.end = end;
+		t.group = &group;
+		push(t);
+	}
+
+	// Block until every task of the group finished, running queued tasks in the meantime
+	void wait(taskGroup& group);
+
+	// Run function(phase) once on every worker and on the calling thread, and return once all finished
+	// The function splits its work into phases separated by phase.sync(), which every thread has to call equally often
+	// Workers stay on the region between phases, so short phases don't wait for workers to be woken up
+	// Only one thread may run a region at a time, and the function must not submit tasks that other threads have to run
+	template<class F>
+	void runPhases(F& function)
+	{
+		phaseBarrier barrier(threadCount + 1);
+		phaseRegion region;
+		region.run = [](void* context, phaseContext& phase) { (*static_cast<F*>(context))(phase); };
+		region.context = &function;
+		region.barrier = &barrier;
+		region.remaining.store(threadCount, std::memory_order_relaxed);
+		startRegion(region);
+
+		phaseContext phase(0, threadCount + 1, &barrier);
+		function(phase);
+		finishRegion(region);
+	}
+
+	int getThreadCount();
+	const schedulerSettings& getSettings();
+
+	// Cores the workers may run on, every available core besides a reserved main core
+	// Threads started after the scheduler inherit the affinity of the thread that started them, which may be the main core only
+	const std::vector<int>& getWorkerCores();
+
+	// Cores the process may run on, as seen before any scheduler changed the affinity of its threads
+	static const std::vector<int>& getAvailableCores();
+
+	// Restrict a thread to the given cores, returns false if the platform refused or doesn't support it
+	static bool setThreadAffinity(std::thread& thread, const std::vector<int>& cores);
+
+private:
+	static constexpr int externalSlots = externalSlotTable::capacity; // Deques reserved for threads outside the pool
+
+	void push(const task& t);
+	bool findTask(int slot, task& t);
+	void execute(task& t);
+	void workerLoop(int slot);
+	void startRegion(phaseRegion& region);
+	void runRegion(int slot);
+	void finishRegion(phaseRegion& region);
+	int getSlot();
+	void placeThreads();
+
+	schedulerSettings settings; // Settings with the thread count resolved
+	int id; // Identifies the scheduler in the thread local slot of a thread
+	int threadCount;
+	int slotCount;
+	taskDeque* deques;
+	std::thread::id owner; // Thread that constructed the scheduler
+	std::vector<int> workerCores;
+	std::shared_ptr<externalSlotTable> external; // Which external deques are held by a thread
+	std::atomic<bool> warnedInline; // Whether running tasks inline for lack of an external deque was logged
+
+	std::vector<std::thread> workers;
+	std::atomic<bool> stopping;
+
+	// Idle workers sleep until the epoch moved on, every submit advances it
+	std::atomic<uint64_t> epoch;
+	std::atomic<int> sleepers;
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+
+	// The current phased region, published before the region epoch moves on
+	std::atomic<phaseRegion*> currentRegion;
+	std::atomic<uint64_t> regionEpoch;
+};
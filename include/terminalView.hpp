@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "log.hpp"
+
+// Console view of the log, refreshed on a thread of its own
+// Every refresh prints only the log entries that were added or changed since the last one, and redraws a status
+// region of fixed height at the top of the terminal, below which the log scrolls
+// When stdout isn't a terminal the status region is left out and the entries are printed without escape codes
+class terminalView
+{
+public:
+	static constexpr int statusHeight = 5; // Caller status, tick phases, frame phases, solve threads and a separator
+
+	terminalView(double nInterval);
+
+	// Start refreshing, restricted to the given cores unless there are none
+	void start(const std::vector<int>& cores = {});
+	void stop();
+
+	// Replace the caller's part of the status region, e.g. fps and tps, shown on its first line
+	void setStatus(const std::vector<std::string>& lines);
+
+private:
+	void loop();
+	void refresh();
+	void appendStatus(std::string& buffer);
+
+	double interval; // Seconds between refreshes
+	bool isTerminal;
+
+	std::thread thread;
+	bool stopping; // Guarded by viewMutex
+	std::mutex viewMutex;
+	std::condition_variable viewCondition;
+	std::vector<std::string> status; // Guarded by viewMutex
+
+	// Only used by the view thread
+	uint64_t revision; // Log revision printed so far
+	std::vector<LogEntry> changes;
+	std::vector<std::string> statusCopy;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Completed scope on the timeline of a thread, names must be string literals
+// The owner thread rewrites the slot once the ring wrapped while a dump may read it, so every field is atomic
+// and a dump only keeps what it read if the slot wasn't reused in the meantime
+struct traceEvent
+{
+	std::atomic<const char*> name;
+	std::atomic<const char*> argName; // nullptr if the event has no argument
+	std::atomic<int64_t> arg;
+	std::atomic<int64_t> start; // Nanoseconds since the tracer epoch
+	std::atomic<int64_t> duration;
+};
+
+// Ring of the latest events of one thread, only the owner thread writes to it
+struct traceBuffer
+{
+	static constexpr int64_t capacity = 1 << 16;
+
+	traceBuffer() : claimed(0), written(0) {}
+
+	std::array<traceEvent, capacity> events;
+	std::atomic<int64_t> claimed; // Events whose slot the owner started to write
+	std::atomic<int64_t> written; // Events written completely, the next one goes to written % capacity
+	char threadName[32];
+};
+
+// Opt-in recorder of per-thread timelines, written as Chrome trace-event JSON that Perfetto and chrome://tracing load
+// While stopped a traced scope costs a single relaxed load, buffers are only allocated for threads that record
+struct tracer
+{
+	static constexpr int maxThreads = 64;
+
+	static void start();
+	static void stop();
+	static bool isRunning();
+
+	// Name the calling thread on the timeline, without it threads are called "thread <index>"
+	// Doesn't allocate the thread's ring, the name is kept until the thread records its first event
+	static void setThreadName(const std::string& name);
+
+	static void record(const char* name, const char* argName, int64_t arg, int64_t start, int64_t duration);
+
+	// Write the events of the latest session still held by the rings, returns the number of events written
+	static int dump(const std::string& filePath);
+
+	// Nanoseconds since the tracer epoch
+	static int64_t now();
+
+private:
+	static traceBuffer* getBuffer();
+
+	static std::atomic<bool> running;
+	static std::atomic<int64_t> sessionStart; // Start of the latest session, dump leaves out older events still in the rings
+	static std::array<std::atomic<traceBuffer*>, maxThreads> buffers;
+	static std::atomic<int> bufferCount;
+};
+
+// Records the lifetime of its scope, if the tracer was running when the scope was entered
+class scopedTrace
+{
+public:
+	scopedTrace(const char* nName, const char* nArgName = nullptr, int64_t nArg = 0)
+	: name(nName), argName(nArgName), arg(nArg), start(tracer::isRunning() ? tracer::now() : -1) {}
+
+	~scopedTrace()
+	{
+		if (start >= 0)
+			tracer::record(name, argName, arg, start, tracer::now() - start);
+	}
+
+private:
+	const char* name;
+	const char* argName;
+	int64_t arg;
+	int64_t start;
+};
+
+#define TRACE_JOIN(a, b) a##b
+#define TRACE_NAME(line) TRACE_JOIN(traceScope, line)
+#define TRACE_SCOPE(name) scopedTrace TRACE_NAME(__LINE__)(name)
+#define TRACE_SCOPE_ARG(name, argName, arg) scopedTrace TRACE_NAME(__LINE__)(name, argName, arg)
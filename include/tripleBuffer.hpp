@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free exchange of the latest value from one writer thread to one reader thread
+// The writer fills getWriteBuffer() and publishes it, the reader switches to the most recently published buffer with acquire()
+// Neither side ever waits, a published buffer the reader didn't pick up in time is overwritten by the next one
+template<class T>
+class tripleBuffer
+{
+public:
+	tripleBuffer() : front(0), back(2), middle(1) {}
+
+	// Buffer the writer may fill, it isn't visible to the reader before publish
+	T& getWriteBuffer() {return buffers[back];}
+
+	// Hand the write buffer to the reader, and continue with the buffer the reader doesn't hold
+	void publish()
+	{
+		int previous = middle.exchange(back | freshBit, std::memory_order_acq_rel);
+		back = previous & indexMask;
+	}
+
+	// Switch to the most recently published buffer, returns false if nothing was published since the last call
+	bool acquire()
+	{
+		if ((middle.load(std::memory_order_relaxed) & freshBit) == 0)
+			return false;
+
+		int previous = middle.exchange(front, std::memory_order_acq_rel);
+		front = previous & indexMask;
+		return true;
+	}
+
+	// Buffer the reader switched to last, stays untouched by the writer until the next acquire
+	const T& getReadBuffer() {return buffers[front];}
+
+private:
+	static constexpr int indexMask = 3;
+	static constexpr int freshBit = 4;
+
+	T buffers[3];
+	int front; // Owned by the reader
+	int back; // Owned by the writer
+	std::atomic<int> middle; // Index of the buffer in between, with freshBit set if it was published and not yet acquired
+};
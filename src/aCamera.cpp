@@ -1,5 +1,16 @@
 #include "aCamera.hpp"
 
+SDL_Color interpolateColor(const SDL_Color& color1, const SDL_Color& color2, double factor)
+{
+    factor = std::max(0.0, std::min(1.0, factor));
+    SDL_Color result;
+    result.r = static_cast<Uint8>(color1.r + (color2.r - color1.r) * factor);
+    result.g = static_cast<Uint8>(color1.g + (color2.g - color1.g) * factor);
+    result.b = static_cast<Uint8>(color1.b + (color2.b - color1.b) * factor);
+    result.a = static_cast<Uint8>(color1.a + (color2.a - color1.a) * factor);
+    return result;
+}
+
 // aCamera class constructor
 aCamera::aCamera(int nWidth, int nHeight, aWindow* nWindow)
 : width(nWidth), height(nHeight), window(nWindow)
@@ -208,6 +219,32 @@ void aCamera::renderDisc(vector2d discPosition, double radius, SDL_Color color,
 
 }
 
+void aCamera::beginDiscs(discBatch& batch)
+{
+	// worldToScreen followed by the scaling of aWindow to the pixels of its screen texture
+	double multiplier = window -> getResolutionMultiplier();
+	double scale = zoomScale * zoom;
+	vector2d offset = {(position.x * scale + width / 2) * multiplier, (position.y * scale + height / 2) * multiplier};
+
+	int w, h;
+	window -> getSize(&w, &h);
+	batch.begin(scale * multiplier, offset, int(w * multiplier), int(h * multiplier));
+}
+
+void aCamera::renderDiscs(discBatch& batch)
+{
+	SDL_Texture* texture = textures["disc"];
+	const SDL_Vertex* vertices = batch.getVertices();
+	for (auto [begin, count] : batch.getRanges())
+	{
+		for (int first = begin; first < begin + count; first += discBatch::discsPerCall)
+		{
+			int discs = std::min(begin + count - first, discBatch::discsPerCall);
+			window -> renderGeometry(texture, vertices + size_t(first) * 4, discs * 4, batch.getIndices(), discs * 6);
+		}
+	}
+}
+
 // Render a colored rectangle on the screen
 void aCamera::renderRect(SDL_FRect rect, SDL_Color color, bool UI)
 {
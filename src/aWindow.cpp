@@ -472,6 +472,25 @@ void aWindow::renderTexture(SDL_Texture* texture, SDL_FRect* source, SDL_FRect*
     }
 }
 
+void aWindow::renderGeometry(SDL_Texture* texture, const SDL_Vertex* vertices, int vertexCount, const int* indices, int indexCount)
+{
+    // renderTexture leaves its color in the modulation of the texture
+    if(!SDL_SetTextureColorMod(texture, 255, 255, 255))
+    {
+    	log::error("aWindow::renderGeometry - Set texture color mod error: {}", SDL_GetError());
+    }
+
+    if(!SDL_SetTextureAlphaMod(texture, 255))
+    {
+    	log::error("aWindow::renderGeometry - Set texture alpha mod error: {}", SDL_GetError());
+    }
+
+    if(!SDL_RenderGeometry(renderer, texture, vertices, vertexCount, indices, indexCount))
+    {
+    	log::error("aWindow::renderGeometry - Render geometry error: {}", SDL_GetError());
+    }
+}
+
 void aWindow::updateSize(int nWidth, int nHeight)
 {
     windowWidth = nWidth;
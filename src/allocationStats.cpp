@@ -0,0 +1,65 @@
+#include "allocationStats.hpp"
+
+#include <cstdlib>
+#include <new>
+
+std::atomic<long long> allocationStats::heapAllocations(0);
+std::atomic<long long> allocationStats::heapBytes(0);
+std::atomic<long long> allocationStats::nodeBlocks(0);
+std::atomic<long long> allocationStats::storeGrowths(0);
+
+// Check if the global operator new is being counted
+bool allocationStats::countsHeap()
+{
+#ifdef PARTICLES_COUNT_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+#ifdef PARTICLES_COUNT_ALLOCATIONS
+
+// Count the allocation and forward it to malloc
+static void* countedAllocate(std::size_t size)
+{
+	allocationStats::heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	allocationStats::heapBytes.fetch_add(size, std::memory_order_relaxed);
+
+	void* pointer = std::malloc(size == 0 ? 1 : size);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new(std::size_t size)
+{
+	return countedAllocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return countedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+#endif
@@ -0,0 +1,67 @@
+#include "broadphase.hpp"
+
+#include "quadTreeBroadphase.hpp"
+#include "linearQuadTree.hpp"
+#include "cellGrid.hpp"
+#include "log.hpp"
+
+// Create a broadphase of the given type covering the simulation space
+broadphase* createBroadphase(broadphaseType type, double halfDimension, int capacity, double cellSize)
+{
+	switch (type)
+	{
+		case broadphaseType::quadTree:
+			return new quadTreeBroadphase(halfDimension, capacity);
+		case broadphaseType::linearQuadTree:
+			return new linearQuadTree(halfDimension, capacity);
+		case broadphaseType::cellGrid:
+			return new cellGrid(halfDimension, cellSize);
+	}
+
+	log::error("createBroadphase - Invalid broadphase type '{}'", int(type));
+	return new quadTreeBroadphase(halfDimension, capacity);
+}
+
+broadphaseType nextBroadphaseType(broadphaseType type)
+{
+	switch (type)
+	{
+		case broadphaseType::quadTree:
+			return broadphaseType::linearQuadTree;
+		case broadphaseType::linearQuadTree:
+			return broadphaseType::cellGrid;
+		case broadphaseType::cellGrid:
+			return broadphaseType::quadTree;
+	}
+	return broadphaseType::quadTree;
+}
+
+std::string getBroadphaseTypeName(broadphaseType type)
+{
+	switch (type)
+	{
+		case broadphaseType::quadTree:
+			return "quadTree";
+		case broadphaseType::linearQuadTree:
+			return "linearQuadTree";
+		case broadphaseType::cellGrid:
+			return "cellGrid";
+	}
+	return "unknown";
+}
+
+bool findBroadphaseType(const std::string& name, broadphaseType& type)
+{
+	broadphaseType candidate = broadphaseType::quadTree;
+	do
+	{
+		if (getBroadphaseTypeName(candidate) == name)
+		{
+			type = candidate;
+			return true;
+		}
+		candidate = nextBroadphaseType(candidate);
+	} while (candidate != broadphaseType::quadTree);
+
+	return false;
+}
@@ -0,0 +1,148 @@
+#include "cellGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+cellGrid::cellGrid(double nHalfDimension, double nMinCellSize)
+:halfDimension(nHalfDimension), minCellSize(nMinCellSize), cellSize(nMinCellSize), slotMask(0)
+{}
+
+// Hash cell coordinates into a slot of the table
+int cellGrid::getSlot(int cellX, int cellY)
+{
+	uint32_t hash = (uint32_t(cellX) * 73856093u) ^ (uint32_t(cellY) * 19349663u);
+	return int(hash & uint32_t(slotMask));
+}
+
+// Collect the distinct slots of all cells touched by the particle, expanded by its diameter
+// The slot of the cell containing the center comes first, returns the number of slots written, at most four
+int cellGrid::getCells(particleStore& store, int index, int* slots)
+{
+	int homeX = int(std::floor((store.x[index] + halfDimension) / cellSize));
+	int homeY = int(std::floor((store.y[index] + halfDimension) / cellSize));
+	int homeSlot = getSlot(homeX, homeY);
+	if (slotStart[homeSlot + 1] == 0)
+		slotCell[homeSlot] = (int64_t(homeX) << 32) | int64_t(uint32_t(homeY));
+	slots[0] = homeSlot;
+
+	double margin = store.radius[index] * 2;
+	int minX = int(std::floor((store.x[index] - margin + halfDimension) / cellSize));
+	int maxX = int(std::floor((store.x[index] + margin + halfDimension) / cellSize));
+	int minY = int(std::floor((store.y[index] - margin + halfDimension) / cellSize));
+	int maxY = int(std::floor((store.y[index] + margin + halfDimension) / cellSize));
+
+	int count = 1;
+	for (int cellY = minY; cellY <= maxY; ++cellY)
+	{
+		for (int cellX = minX; cellX <= maxX; ++cellX)
+		{
+			int slot = getSlot(cellX, cellY);
+
+			// Cells sharing a slot must not list the particle twice
+			if (std::find(slots, slots + count, slot) != slots + count)
+				continue;
+
+			if (slotStart[slot + 1] == 0)
+				slotCell[slot] = (int64_t(cellX) << 32) | int64_t(uint32_t(cellY));
+
+			slots[count++] = slot;
+		}
+	}
+	return count;
+}
+
+// Bin all particles into the hash table with a counting sort
+void cellGrid::build(particleStore& store)
+{
+	int count = store.getCount();
+
+	// Cells are at least four radii wide, so the expanded bounds of
+	// a particle never touch more than 2x2 cells
+	double maxRadius = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		maxRadius = std::max(maxRadius, store.radius[i]);
+	}
+	cellSize = std::max(minCellSize, maxRadius * 4);
+
+	// Keep at least twice as many slots as particles to limit collisions
+	int slotCount = 1024;
+	while (slotCount < count * 2)
+		slotCount *= 2;
+	slotMask = slotCount - 1;
+
+	slotStart.assign(slotCount + 1, 0);
+	slotHomeCount.assign(slotCount, 0);
+	slotCell.resize(slotCount);
+	particleSlots.resize(size_t(count) * 4);
+
+	// Count the particles of every slot
+	for (int i = 0; i < count; ++i)
+	{
+		int* slots = &particleSlots[size_t(i) * 4];
+		int n = getCells(store, i, slots);
+		slotHomeCount[slots[0]]++;
+		for (int k = 0; k < n; ++k)
+		{
+			slotStart[slots[k] + 1]++;
+		}
+		for (int k = n; k < 4; ++k)
+		{
+			slots[k] = -1;
+		}
+	}
+
+	// Turn the counts into offsets
+	for (int slot = 0; slot < slotCount; ++slot)
+	{
+		slotStart[slot + 1] += slotStart[slot];
+	}
+
+	// Scatter the particles into their slots, the particles centered in a slot's cells go first
+	entries.resize(slotStart[slotCount]);
+	slotCursor.assign(slotStart.begin(), slotStart.end() - 1);
+	for (int i = 0; i < count; ++i)
+	{
+		entries[slotCursor[particleSlots[size_t(i) * 4]]++] = i;
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		int* slots = &particleSlots[size_t(i) * 4];
+		for (int k = 1; k < 4 && slots[k] >= 0; ++k)
+		{
+			entries[slotCursor[slots[k]]++] = i;
+		}
+	}
+}
+
+// Retrieve every occupied slot as a leaf
+void cellGrid::getLeaves(std::vector<broadphaseLeaf>& leaves)
+{
+	for (int slot = 0; slot + 1 < int(slotStart.size()); ++slot)
+	{
+		int count = slotStart[slot + 1] - slotStart[slot];
+		if (count == 0)
+			continue;
+
+		int cellX = int(slotCell[slot] >> 32);
+		int cellY = int(int32_t(uint32_t(slotCell[slot])));
+		quadTreeBox boundary(vector2d((cellX + 0.5) * cellSize - halfDimension, (cellY + 0.5) * cellSize - halfDimension), cellSize / 2);
+
+		leaves.push_back({boundary, entries.data() + slotStart[slot], count, slotHomeCount[slot]});
+	}
+}
+
+void cellGrid::clear()
+{
+	slotStart.clear();
+	slotCursor.clear();
+	slotHomeCount.clear();
+	slotCell.clear();
+	entries.clear();
+	particleSlots.clear();
+}
+
+std::string cellGrid::getName()
+{
+	return "cellGrid";
+}
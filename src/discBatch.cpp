@@ -0,0 +1,84 @@
+#include "discBatch.hpp"
+
+// discBatch class constructor
+discBatch::discBatch()
+{
+	// Every call reuses the same quads, 0-1-2 and 2-3-0 of every four vertices
+	indices.resize(size_t(discsPerCall) * 6);
+	for (int d = 0; d < discsPerCall; ++d)
+	{
+		int* quad = &indices[size_t(d) * 6];
+		quad[0] = d * 4;
+		quad[1] = d * 4 + 1;
+		quad[2] = d * 4 + 2;
+		quad[3] = d * 4 + 2;
+		quad[4] = d * 4 + 3;
+		quad[5] = d * 4;
+	}
+	count = 0;
+
+	// Transform
+	scale = 1;
+	offset = vector2d(0, 0);
+	targetWidth = 0;
+	targetHeight = 0;
+}
+
+void discBatch::begin(double nScale, vector2d nOffset, double nTargetWidth, double nTargetHeight)
+{
+	ranges.clear();
+	count = 0;
+	scale = nScale;
+	offset = nOffset;
+	targetWidth = nTargetWidth;
+	targetHeight = nTargetHeight;
+}
+
+void discBatch::add(vector2d position, double radius, SDL_Color color)
+{
+	int slot = ranges.empty() ? 0 : ranges.back().first + ranges.back().second;
+	if (size_t(slot + 1) * 4 > vertices.size())
+		vertices.resize(std::max<size_t>(1024, vertices.size() * 2));
+
+	if (setDisc(slot, position.x, position.y, radius, color))
+		addRange(slot, 1);
+}
+
+void discBatch::reserve(int discs)
+{
+	if (size_t(discs) * 4 > vertices.size())
+		vertices.resize(size_t(discs) * 4);
+}
+
+void discBatch::addRange(int first, int discs)
+{
+	if (discs <= 0)
+		return;
+
+	// Runs that continue the last one are merged, so serially added discs stay a single range
+	if (!ranges.empty() && ranges.back().first + ranges.back().second == first)
+		ranges.back().second += discs;
+	else
+		ranges.push_back({first, discs});
+	count += discs;
+}
+
+int discBatch::getCount()
+{
+	return count;
+}
+
+const std::vector<std::pair<int, int>>& discBatch::getRanges()
+{
+	return ranges;
+}
+
+const SDL_Vertex* discBatch::getVertices()
+{
+	return vertices.data();
+}
+
+const int* discBatch::getIndices()
+{
+	return indices.data();
+}
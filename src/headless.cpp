@@ -0,0 +1,139 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "log.hpp"
+#include "scenario.hpp"
+#include "simulation.hpp"
+#include "trace.hpp"
+
+// Write position, velocity and radius of every particle as CSV
+static bool writeState(simulationContainer& simulation, const std::string& filePath)
+{
+    FILE* file = fopen(filePath.c_str(), "w");
+    if (file == nullptr)
+    {
+        log::error("headless - Could not open output file {}", filePath);
+        return false;
+    }
+
+    fmt::print(file, "x,y,vx,vy,radius\n");
+    for (int i = 0; i < simulation.getParticleCount(); ++i)
+    {
+        particle p = simulation.getParticle(i);
+        vector2d position = p.getPosition();
+        vector2d velocity = p.getVelocity();
+        fmt::print(file, "{},{},{},{},{}\n", position.x, position.y, velocity.x, velocity.y, p.getRadius());
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char* args[])
+{
+    log::initFile("particles_headless.log");
+
+    // particles_headless <scenario> [--ticks <count>] [--threads <count>] [--iterations <count>]
+    //                    [--execution forkJoin|phased|graph] [--output <file>] [--trace <file>]
+    // Flags override the values of the scenario file
+    std::string scenarioPath;
+    std::string outputPath = "final_state.csv";
+    std::string tracePath;
+    schedulerSettings settings;
+    int ticks = -1;
+    int iterations = 0;
+    executionMode execution = executionMode::graph;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = args[i];
+        if (arg == "--ticks" && i + 1 < argc)
+            ticks = std::atoi(args[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            settings.threadCount = std::atoi(args[++i]);
+        else if (arg == "--iterations" && i + 1 < argc)
+            iterations = std::atoi(args[++i]);
+        else if (arg == "--output" && i + 1 < argc)
+            outputPath = args[++i];
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = args[++i];
+        else if (arg == "--execution" && i + 1 < argc)
+        {
+            std::string mode = args[++i];
+            if (mode == "forkJoin")
+                execution = executionMode::forkJoin;
+            else if (mode == "phased")
+                execution = executionMode::phased;
+            else if (mode == "graph")
+                execution = executionMode::graph;
+            else
+                log::error("headless - Unknown execution mode '{}'", mode);
+        }
+        else if (scenarioPath.empty() && arg[0] != '-')
+            scenarioPath = arg;
+        else
+            log::error("headless - Unknown argument '{}'", arg);
+    }
+
+    if (scenarioPath.empty())
+    {
+        fmt::print("usage: particles_headless <scenario> [--ticks N] [--threads N] [--iterations N] [--execution forkJoin|phased|graph] [--output file] [--trace file]\n");
+        return 1;
+    }
+
+    scenario setup;
+    if (!setup.load(scenarioPath))
+    {
+        fmt::print("Could not load scenario {}, see particles_headless.log\n", scenarioPath);
+        return 1;
+    }
+    if (ticks >= 0)
+        setup.ticks = ticks;
+    if (iterations > 0)
+        setup.iterationSteps = iterations;
+
+    simulationContainer* simulation = new simulationContainer(settings);
+    simulation->setExecutionMode(execution);
+    setup.apply(*simulation);
+
+    fmt::print("{}: {} particles, {} ticks, {} broadphase, {}\n", scenarioPath, simulation->getParticleCount(), setup.ticks, simulation->getBroadphaseName(), simulation->getSchedulerName());
+
+    if (!tracePath.empty())
+    {
+        tracer::setThreadName("main");
+        tracer::start();
+    }
+
+    long long pairTests = 0;
+    long long particleTicks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < setup.ticks; ++tick)
+    {
+        TRACE_SCOPE("tick");
+        particleTicks += simulation->getParticleCount();
+        simulation->update();
+        pairTests += simulation->getStats().pairTests;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!tracePath.empty())
+    {
+        tracer::stop();
+        tracer::dump(tracePath);
+    }
+    if (seconds <= 0)
+        seconds = 1e-9;
+
+    fmt::print("elapsed          {:.3f} s\n", seconds);
+    fmt::print("ticks/s          {:.1f}\n", setup.ticks / seconds);
+    fmt::print("pair tests/s     {:.4g}\n", pairTests / seconds);
+    fmt::print("particle ticks/s {:.4g}\n", particleTicks / seconds);
+    fmt::print("particles left   {}\n", simulation->getParticleCount());
+
+    bool written = writeState(*simulation, outputPath);
+    if (written)
+        fmt::print("final state      {}\n", outputPath);
+
+    simulation->cleanUp();
+    delete simulation;
+    return written ? 0 : 1;
+}
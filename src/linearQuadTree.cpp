@@ -0,0 +1,192 @@
+#include "linearQuadTree.hpp"
+
+#include <algorithm>
+
+#include "morton.hpp"
+
+linearQuadTree::linearQuadTree(double nHalfDimension, int nCapacity)
+:halfDimension(nHalfDimension), capacity(nCapacity)
+{}
+
+// Split a node into four children if it holds too many particles
+// Children of a node are consecutive ranges of the sorted keys, ordered nw, ne, sw, se
+void linearQuadTree::split(int node, int level)
+{
+	int begin = nodes[node].begin;
+	int end = nodes[node].end;
+	quadTreeBox boundary = nodes[node].boundary;
+
+	// Check if splitting is necessary
+	if ((end - begin <= capacity) || (boundary.halfDimension/2 <= 2) || level >= 15)
+	{
+		nodes[node].leaf = int(leafNodes.size());
+		leafNodes.push_back(node);
+		return;
+	}
+
+	// The two key bits below the node's prefix select the child
+	int shift = 30 - level * 2;
+	int firstChild = int(nodes.size());
+	nodes[node].firstChild = firstChild;
+
+	int childBegin = begin;
+	for (uint32_t code = 0; code < 4; ++code)
+	{
+		auto childEnd = std::partition_point(keys.begin() + childBegin, keys.begin() + end,
+			[shift, code](uint32_t key) { return ((key >> shift) & 3) <= code; });
+
+		linearQuadTreeNode child;
+		child.boundary.halfDimension = boundary.halfDimension / 2;
+		child.boundary.center.x = boundary.center.x + ((code & 1) ? 1 : -1) * (boundary.halfDimension / 2);
+		child.boundary.center.y = boundary.center.y + ((code & 2) ? 1 : -1) * (boundary.halfDimension / 2);
+		child.begin = childBegin;
+		child.end = int(childEnd - keys.begin());
+		child.parent = node;
+		child.firstChild = -1;
+		child.leaf = -1;
+		nodes.push_back(child);
+
+		childBegin = child.end;
+	}
+
+	// Split the children recursively, which numbers the leaves in Z-order
+	for (int child = firstChild; child < firstChild + 4; ++child)
+	{
+		split(child, level + 1);
+	}
+}
+
+// Record a ghost for every leaf, other than its home, overlapped by the particle's bounds
+void linearQuadTree::insertGhost(int node, int index, quadTreeBox bounds, int home)
+{
+	if (!nodes[node].boundary.overlaps(bounds))
+		return;
+
+	if (nodes[node].firstChild < 0)
+	{
+		if (nodes[node].leaf != home)
+		{
+			ghostLeaf.push_back(nodes[node].leaf);
+			ghostParticle.push_back(index);
+		}
+		return;
+	}
+
+	for (int child = nodes[node].firstChild; child < nodes[node].firstChild + 4; ++child)
+	{
+		insertGhost(child, index, bounds, home);
+	}
+}
+
+// Sort the particles along the Z-order curve and build the tree over the sorted array
+void linearQuadTree::build(particleStore& store)
+{
+	int count = store.getCount();
+
+	keys.resize(count);
+	order.resize(count);
+	for (int i = 0; i < count; ++i)
+	{
+		keys[i] = mortonKey(store.x[i], store.y[i], halfDimension);
+		order[i] = i;
+	}
+	radixSort(keys, order, keyScratch, orderScratch);
+
+	nodes.clear();
+	leafNodes.clear();
+
+	linearQuadTreeNode root;
+	root.boundary = quadTreeBox(vector2d(0, 0), halfDimension);
+	root.begin = 0;
+	root.end = count;
+	root.parent = -1;
+	root.firstChild = -1;
+	root.leaf = -1;
+	nodes.push_back(root);
+	split(0, 0);
+
+	int leafCount = int(leafNodes.size());
+
+	particleLeaf.resize(count);
+	for (int leaf = 0; leaf < leafCount; ++leaf)
+	{
+		linearQuadTreeNode& node = nodes[leafNodes[leaf]];
+		for (int k = node.begin; k < node.end; ++k)
+		{
+			particleLeaf[order[k]] = leaf;
+		}
+	}
+
+	// Find the ghosts of particles near the edge of their leaf, starting from the closest ancestor covering them
+	ghostLeaf.clear();
+	ghostParticle.clear();
+	for (int i = 0; i < count; ++i)
+	{
+		quadTreeBox bounds({store.x[i], store.y[i]}, store.radius[i] * 2);
+		int home = particleLeaf[i];
+		int node = leafNodes[home];
+		if (nodes[node].boundary.covers(bounds))
+			continue;
+
+		while (nodes[node].parent >= 0 && !nodes[node].boundary.covers(bounds))
+		{
+			node = nodes[node].parent;
+		}
+		insertGhost(node, i, bounds, home);
+	}
+
+	// Lay out every leaf as its sorted range followed by its ghosts
+	leafStart.assign(leafCount + 1, 0);
+	for (int leaf = 0; leaf < leafCount; ++leaf)
+	{
+		leafStart[leaf + 1] = nodes[leafNodes[leaf]].end - nodes[leafNodes[leaf]].begin;
+	}
+	for (int leaf : ghostLeaf)
+	{
+		leafStart[leaf + 1]++;
+	}
+	for (int leaf = 0; leaf < leafCount; ++leaf)
+	{
+		leafStart[leaf + 1] += leafStart[leaf];
+	}
+
+	entries.resize(leafStart[leafCount]);
+	leafCursor.resize(leafCount);
+	for (int leaf = 0; leaf < leafCount; ++leaf)
+	{
+		linearQuadTreeNode& node = nodes[leafNodes[leaf]];
+		std::copy(order.begin() + node.begin, order.begin() + node.end, entries.begin() + leafStart[leaf]);
+		leafCursor[leaf] = leafStart[leaf] + node.end - node.begin;
+	}
+	for (size_t g = 0; g < ghostLeaf.size(); ++g)
+	{
+		entries[leafCursor[ghostLeaf[g]]++] = ghostParticle[g];
+	}
+}
+
+// Retrieve all non-empty leaves in Z-order
+void linearQuadTree::getLeaves(std::vector<broadphaseLeaf>& leaves)
+{
+	for (int leaf = 0; leaf + 1 < int(leafStart.size()); ++leaf)
+	{
+		int count = leafStart[leaf + 1] - leafStart[leaf];
+		if (count == 0)
+			continue;
+
+		linearQuadTreeNode& node = nodes[leafNodes[leaf]];
+		leaves.push_back({node.boundary, entries.data() + leafStart[leaf], count, node.end - node.begin});
+	}
+}
+
+void linearQuadTree::clear()
+{
+	nodes.clear();
+	leafNodes.clear();
+	leafStart.clear();
+	entries.clear();
+}
+
+std::string linearQuadTree::getName()
+{
+	return "linearQuadTree";
+}
@@ -0,0 +1,240 @@
+#include "log.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+log::log()
+{
+	// Logging threads
+	for (auto& buffer : buffers)
+	{
+		buffer.store(nullptr, std::memory_order_relaxed);
+	}
+	bufferCount.store(0, std::memory_order_relaxed);
+
+	// Writer
+	stopping.store(false, std::memory_order_relaxed);
+	flushRequested.store(0, std::memory_order_relaxed);
+	flushCompleted = 0;
+
+	// History
+	firstEntry = 0;
+	revision = 0;
+
+	writer = std::thread(&log::writerLoop, this);
+}
+
+// Write what is still queued before the process exits
+log::~log()
+{
+	stopping.store(true, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		wakeCondition.notify_one();
+	}
+	writer.join();
+}
+
+class log& log::getInstance()
+{
+	static log instance;
+	return instance;
+}
+
+void log::initFile(const std::string& filename)
+{
+	auto& instance = getInstance();
+	std::lock_guard<std::mutex> lock(instance.fileMutex);
+	instance.fileStream.emplace(filename, std::ios::out | std::ios::trunc);
+}
+
+// Ring of the calling thread, created on its first message
+LogBuffer* log::getBuffer()
+{
+	thread_local LogBuffer* buffer = nullptr;
+	thread_local bool full = false;
+	if (buffer != nullptr || full)
+		return buffer;
+
+	int index = bufferCount.fetch_add(1, std::memory_order_relaxed);
+	if (index >= maxThreads)
+	{
+		full = true;
+		return nullptr;
+	}
+
+	buffer = new LogBuffer();
+	buffers[index].store(buffer, std::memory_order_release);
+	return buffer;
+}
+
+void log::push(LogLevel level, std::string message)
+{
+	auto& instance = getInstance();
+	auto time = std::chrono::system_clock::now();
+
+	LogBuffer* buffer = instance.getBuffer();
+	if (buffer == nullptr)
+	{
+		std::lock_guard<std::mutex> lock(instance.overflowMutex);
+		instance.overflow.push_back({level, std::move(message), time});
+		return;
+	}
+
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	uint64_t pending = head - buffer->tail.load(std::memory_order_acquire);
+	if (pending >= LogBuffer::capacity)
+	{
+		buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	LogRecord& record = buffer->records[head % LogBuffer::capacity];
+	record.level = level;
+	record.message = std::move(message);
+	record.time = time;
+	buffer->head.store(head + 1, std::memory_order_release);
+
+	// Wake the writer early once the ring fills up, otherwise it picks the messages up on its next round
+	if (pending + 1 == LogBuffer::capacity / 2)
+		instance.wakeCondition.notify_one();
+}
+
+void log::flush()
+{
+	auto& instance = getInstance();
+	std::unique_lock<std::mutex> lock(instance.wakeMutex);
+	uint64_t request = instance.flushRequested.fetch_add(1, std::memory_order_seq_cst) + 1;
+	instance.wakeCondition.notify_one();
+	instance.flushCondition.wait(lock, [&instance, request]() { return instance.flushCompleted >= request; });
+}
+
+void log::writerLoop()
+{
+	while (true)
+	{
+		uint64_t request;
+		{
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wakeCondition.wait_for(lock, std::chrono::milliseconds(50), [this]()
+			{
+				return stopping.load(std::memory_order_relaxed) || flushRequested.load(std::memory_order_relaxed) != flushCompleted;
+			});
+			request = flushRequested.load(std::memory_order_seq_cst);
+		}
+
+		drain();
+
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		flushCompleted = request;
+		flushCondition.notify_all();
+		if (stopping.load(std::memory_order_relaxed))
+			break;
+	}
+}
+
+// Take the messages of every ring, write them to the file in one go and add them to the history
+void log::drain()
+{
+	batch.clear();
+	uint64_t dropped = 0;
+	int count = std::min(bufferCount.load(std::memory_order_relaxed), maxThreads);
+	for (int t = 0; t < count; ++t)
+	{
+		LogBuffer* buffer = buffers[t].load(std::memory_order_acquire);
+		if (buffer == nullptr)
+			continue;
+
+		uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		for (uint64_t i = tail; i < head; ++i)
+		{
+			batch.push_back(std::move(buffer->records[i % LogBuffer::capacity]));
+		}
+		buffer->tail.store(head, std::memory_order_release);
+		dropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+	}
+	{
+		std::lock_guard<std::mutex> lock(overflowMutex);
+		std::move(overflow.begin(), overflow.end(), std::back_inserter(batch));
+		overflow.clear();
+	}
+
+	if (dropped > 0)
+		batch.push_back({LogLevel::Error, fmt::format("log::drain - Dropped {} messages of threads logging faster than they were written", dropped), std::chrono::system_clock::now()});
+
+	if (batch.empty())
+		return;
+
+	// Every ring is in order already, sorting merges the threads
+	std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) { return a.time < b.time; });
+
+	text.clear();
+	std::lock_guard<std::mutex> historyLock(historyMutex);
+	for (const auto& record : batch)
+	{
+		std::string timestamp = formatTime(record.time);
+		fmt::format_to(std::back_inserter(text), "[{}] {} - {}\n", (record.level == LogLevel::Error) ? "ERROR" : "INFO", timestamp, record.message);
+		addToHistory(record, timestamp);
+	}
+
+	std::lock_guard<std::mutex> fileLock(fileMutex);
+	if (fileStream && fileStream->is_open())
+	{
+		fileStream->write(text.data(), text.size());
+		fileStream->flush();
+	}
+}
+
+// Append the record to the history, or count it on the entry of the same error
+void log::addToHistory(const LogRecord& record, const std::string& timestamp)
+{
+	std::hash<std::string> hasher;
+	size_t hash = 0;
+	if (record.level == LogLevel::Error)
+	{
+		hash = hasher(record.message);
+		auto found = errorEntries.find(hash);
+		if (found != errorEntries.end() && found->second >= firstEntry)
+		{
+			LogEntry& entry = entries[found->second - firstEntry];
+			if (entry.message == record.message)
+			{
+				entry.timestamp = timestamp;
+				entry.calls += 1;
+				entry.revision = ++revision;
+				return;
+			}
+		}
+	}
+
+	if (entries.size() >= historyCapacity)
+	{
+		const LogEntry& oldest = entries.front();
+		if (oldest.level == LogLevel::Error)
+		{
+			auto found = errorEntries.find(hasher(oldest.message));
+			if (found != errorEntries.end() && found->second == firstEntry)
+				errorEntries.erase(found);
+		}
+		entries.pop_front();
+		firstEntry++;
+	}
+
+	if (record.level == LogLevel::Error)
+		errorEntries[hash] = firstEntry + entries.size();
+	entries.push_back({record.level, record.message, timestamp, 1, ++revision});
+}
+
+uint64_t log::getChanges(uint64_t since, std::vector<LogEntry>& changed)
+{
+	auto& instance = getInstance();
+	changed.clear();
+	std::lock_guard<std::mutex> lock(instance.historyMutex);
+	for (const auto& entry : instance.entries)
+	{
+		if (entry.revision > since)
+			changed.push_back(entry);
+	}
+	return instance.revision;
+}
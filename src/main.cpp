@@ -2,19 +2,50 @@
 #include <SDL3/SDL_render.h>
 #include <SDL3/SDL_main.h>
 #include <cstdlib>
+#include <string>
 
 #include "manager.hpp"
 
 int main(int argc, char* args[])
 {
     log::initFile("particles.log");
+
+    // --threads <count> sets the worker threads, --pin binds each worker to a core,
+    // --reserve-main-core keeps the workers off the core of the main thread,
+    // --trace <file> records a trace from the start and writes it to the file on exit
+    schedulerSettings settings;
+    std::string tracePath;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = args[i];
+        if (arg == "--threads" && i + 1 < argc)
+            settings.threadCount = std::atoi(args[++i]);
+        else if (arg == "--pin")
+            settings.pinning = true;
+        else if (arg == "--reserve-main-core")
+            settings.reserveMainCore = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = args[++i];
+        else
+            log::error("main - Unknown argument '{}'", arg);
+    }
+
     fmt::print("\033[?1049h");  // Enter alternate screen buffer
     fmt::print("\033[?25l");     // Hide cursor
     fflush(stdout);
 
-    manager* m = new manager();
+    if (!tracePath.empty())
+        tracer::start();
+
+    manager* m = new manager(settings);
     m->loop();
 
+    if (!tracePath.empty())
+    {
+        tracer::stop();
+        tracer::dump(tracePath);
+    }
+
     fmt::print("\033[?1049l");  // Exit alternate screen buffer
     fmt::print("\033[?25h");     // Show cursor
     fflush(stdout);
@@ -1,6 +1,6 @@
 #include "manager.hpp"
 
-manager::manager()
+manager::manager(const schedulerSettings& nSettings)
 {
 	newTime = 0;
 	frameTime = 0;
@@ -14,7 +14,6 @@ manager::manager()
 	displayFps = "";
 
 	timeStep = 0;
-	tickCount = 0;
 	tpsTimer = 0;
 	tps = 0;
 	displayTps = "";
@@ -31,9 +30,22 @@ manager::manager()
 
 	p = nullptr;
 	container = nullptr;
+	simulation = nullptr;
+	renderer = nullptr;
+	view = nullptr;
+	isPlacingParticle = false;
+	placeParticlePosition = vector2d(0, 0);
 	particleSpawnCount = 1;
 	displayParticleCount = "";
 	displaySimulationState = "";
+	displayBroadphase = "";
+	displayAllocations = "";
+	settings = nSettings;
+	// By default one worker per core besides the main thread and the simulation thread, which runs tasks while it waits
+	if (settings.threadCount <= 0)
+		settings.threadCount = std::max(1, int(taskScheduler::getAvailableCores().size()) - 2);
+	displayThreads = "";
+	displayEnergy = "";
 
 	camera = nullptr;
 	window = nullptr;
@@ -86,14 +98,18 @@ void manager::update()
 			// Spawn particles when F is held
 			if(keyState[SDL_SCANCODE_F])
 			{
+				std::vector<vector2d> positions;
 				for (int i = 0; i < particleSpawnCount; ++i)
-					container -> addParticle(camera -> screenToWorld(vector2d(mouseX+double(i)/1000, mouseY+double(i)/1000)), 5);	
+					positions.push_back(camera -> screenToWorld(vector2d(mouseX+double(i)/1000, mouseY+double(i)/1000)));
+				simulation -> post([positions](simulationContainer& c)
+				{
+					for (vector2d position : positions)
+						c.addParticle(position, 5);
+				});
 			}		
 
 			camera -> updateZoom();
 			camera -> updatePosition();
-			if(container -> getRunning())
-				container -> update();
 			if(debugMenu != nullptr)
 				debugMenu -> update(camera, {0, 0, float(w), float(h)}, debugMenu);
 			if(controlsMenu != nullptr)
@@ -125,11 +141,35 @@ void manager::render()
 			float mouseX, mouseY;
 			SDL_GetMouseState(&mouseX, &mouseY);
 			
-			mainGrid -> render(camera);
+			{
+				TIME_PHASE(timedPhase::renderGrid);
+				TRACE_SCOPE("grid");
+				mainGrid -> render(camera);
+			}
+
+			// Draw the latest snapshot, interpolated between its last two ticks by the time passed since it was published
+			container -> acquireSnapshot();
+			const particleSnapshot& snapshot = container -> getSnapshot();
+			double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			double alpha = (snapshot.tickInterval > 0) ? clamp((now - snapshot.publishTime) / snapshot.tickInterval, 0, 1) : 1;
+
+			{
+				TIME_PHASE(timedPhase::renderParticles);
+				TRACE_SCOPE("particles");
+				renderer -> render(camera, alpha);
+			}
+			{
+				TIME_PHASE(timedPhase::renderBroadphase);
+				TRACE_SCOPE("leaves");
+				renderer -> renderBroadphase(camera, {mouseX, mouseY});
+			}
 
-			container -> render(camera);
-			container -> renderQuadTree(camera, {mouseX, mouseY});
+			// Render placing particle preview line if necessary
+			if(isPlacingParticle)
+				camera -> renderLine(placeParticlePosition, camera -> screenToWorld(vector2d(mouseX, mouseY)), 0.1, {255, 0, 0, 255}, false);
 
+			TIME_PHASE(timedPhase::renderMenus);
+			TRACE_SCOPE("menus");
 			if(debugMenu != nullptr)
 			 	debugMenu -> render(camera, {0, 0, float(w), float(h)}, debugMenu);
 			if(controlsMenu != nullptr)
@@ -143,6 +183,8 @@ void manager::render()
 		}
 	}
 
+	TIME_PHASE(timedPhase::display);
+	TRACE_SCOPE("display");
 	window -> display();
 }
 
@@ -163,7 +205,6 @@ void manager::init()
 	displayFps = "fps: 0";
 
 	timeStep = 0.01;
-	tickCount = 0;
 	tpsTimer = 0.0;
 	tps = 0;
 	displayTps = "tps: 0";
@@ -183,7 +224,19 @@ void manager::init()
 	camera -> setSize(w, h);
 	camera -> loadTextures();
 
-	container = new simulationContainer();
+	// The scheduler binds this thread to the main core when it is reserved, so the threads started
+	// after it would inherit that core, they share the cores of the workers instead
+	container = new simulationContainer(settings);
+	std::vector<int> cores;
+	if (container -> getScheduler() -> getSettings().reserveMainCore)
+		cores = container -> getScheduler() -> getWorkerCores();
+
+	simulation = new simulationThread(container, timeStep);
+	renderer = new simulationRenderer(container, settings);
+	simulation -> start(cores);
+
+	view = new terminalView(0.5);
+	view -> start(cores);
 
 	mainGrid = new grid(vector2d(0, 0), 1024, 1024, 16, 16);
 
@@ -230,6 +283,58 @@ void manager::loadMenus()
 	    menu->text = &displaySimulationState;
 	}
 	menu = nullptr;
+	menu = dynamic_cast<menuText*>(debugMenu->getById("broadphase"));
+	if (menu)
+	{
+		delete menu->text;
+		menu->textOwned = false;
+	    menu->text = &displayBroadphase;
+	}
+	menu = nullptr;
+	menu = dynamic_cast<menuText*>(debugMenu->getById("allocations"));
+	if (menu)
+	{
+		delete menu->text;
+		menu->textOwned = false;
+	    menu->text = &displayAllocations;
+	}
+	menu = nullptr;
+	menu = dynamic_cast<menuText*>(debugMenu->getById("threads"));
+	if (menu)
+	{
+		delete menu->text;
+		menu->textOwned = false;
+	    menu->text = &displayThreads;
+	}
+	menu = nullptr;
+	menu = dynamic_cast<menuText*>(debugMenu->getById("energy"));
+	if (menu)
+	{
+		delete menu->text;
+		menu->textOwned = false;
+	    menu->text = &displayEnergy;
+	}
+	menu = nullptr;
+
+	// Phase timers are bound to the texts named after the phase, like "integrateTime"
+	for (int phase = 0; phase < int(timedPhase::count); ++phase)
+	{
+		menu = dynamic_cast<menuText*>(debugMenu->getById(std::string(phaseTimers::getName(timedPhase(phase))) + "Time"));
+		if (menu)
+		{
+			delete menu->text;
+			menu->textOwned = false;
+			menu->text = &displayPhaseTimes[phase];
+		}
+	}
+	menu = dynamic_cast<menuText*>(debugMenu->getById("solveThreadsTime"));
+	if (menu)
+	{
+		delete menu->text;
+		menu->textOwned = false;
+	    menu->text = &displaySolveThreads;
+	}
+	menu = nullptr;
 }
 
 // Color division is sick, you know what unites us?
@@ -238,8 +343,10 @@ void manager::loadMenus()
 void manager::loop()
 {
 	init();
+	tracer::setThreadName("main");
 	while (running)
 	{
+		TRACE_SCOPE("frame");
 		newTime = SDL_GetTicks() * 0.001;
 	    frameTime = newTime - currentTime;
 	    currentTime = newTime;
@@ -247,75 +354,101 @@ void manager::loop()
 
 		while (accumulator >= timeStep)
 		{
+			TRACE_SCOPE("input");
 			float mouseX, mouseY;
 			SDL_GetMouseState(&mouseX, &mouseY);
 
 			// Event handling loop
-			while (SDL_PollEvent(&event))
 			{
-				int w, h;
-				switch (event.type)
+				TIME_PHASE(timedPhase::events);
+				TRACE_SCOPE("events");
+				while (SDL_PollEvent(&event))
 				{
-					case SDL_EVENT_QUIT:
-						running = false;
-						break;
-
-					case SDL_EVENT_MOUSE_BUTTON_DOWN:
-						// Start placing a particle, this will be it's position
-						if (event.button.button == SDL_BUTTON_LEFT)
-						{		
-							container -> placeParticle(camera -> screenToWorld(vector2d(mouseX, mouseY)), 50, 0);
-						}
-						break;
-
-					case SDL_EVENT_MOUSE_BUTTON_UP:
-						// Finish placing a particle, it's velocity will be pointing towards this point
-						if (event.button.button == SDL_BUTTON_LEFT)
-						{
-							container -> placeParticle(camera -> screenToWorld(vector2d(mouseX, mouseY)), 50, 1);
-						}
-						break;
-					
-					case SDL_EVENT_KEY_DOWN:
-						switch (event.key.key)
-						{
-							case SDLK_F11:
-								// Toggle fullscreen mode
-								window -> switchFullscreen();
-								break;
-							case SDLK_SPACE:
-								// Toggle simulation running
-								container -> switchRunning();
-								break;
-							case SDLK_R:
-								// Advance the simulation by 1 tick
-								container -> update();
-								break;
-							case SDLK_Z:
-								// Display a debug overlay of a hovered quadrant
-								container -> select(camera);
-								break;
+					int w, h;
+					switch (event.type)
+					{
+						case SDL_EVENT_QUIT:
+							running = false;
+							break;
+
+						case SDL_EVENT_MOUSE_BUTTON_DOWN:
+							// Start placing a particle, this will be it's position
+							if (event.button.button == SDL_BUTTON_LEFT)
+							{		
+								vector2d position = camera -> screenToWorld(vector2d(mouseX, mouseY));
+								isPlacingParticle = true;
+								placeParticlePosition = position;
+								simulation -> post([position](simulationContainer& c) { c.placeParticle(position, 50, 0); });
+							}
+							break;
+
+						case SDL_EVENT_MOUSE_BUTTON_UP:
+							// Finish placing a particle, it's velocity will be pointing towards this point
+							if (event.button.button == SDL_BUTTON_LEFT)
+							{
+								vector2d position = camera -> screenToWorld(vector2d(mouseX, mouseY));
+								isPlacingParticle = false;
+								simulation -> post([position](simulationContainer& c) { c.placeParticle(position, 50, 1); });
 							}
-						break;
-					case SDL_EVENT_WINDOW_RESIZED:
-						w = event.window.data1;
-                		h = event.window.data2; 
-
-						window -> updateSize(w, h);
-						camera -> setSize(w, h);
-						break;
-					case SDL_EVENT_MOUSE_WHEEL:
-						if(event.wheel.y > 0)
-							particleSpawnCount += 1;
-						if(event.wheel.y < 0)
-							particleSpawnCount += (particleSpawnCount > 1) ? -1 : 0;
-						break;
-				}	
+							break;
+					
+						case SDL_EVENT_KEY_DOWN:
+							switch (event.key.key)
+							{
+								case SDLK_F11:
+									// Toggle fullscreen mode
+									window -> switchFullscreen();
+									break;
+								case SDLK_SPACE:
+									// Toggle simulation running
+									simulation -> post([](simulationContainer& c) { c.switchRunning(); });
+									break;
+								case SDLK_R:
+									// Advance the simulation by 1 tick
+									simulation -> post([](simulationContainer& c) { c.update(); });
+									break;
+								case SDLK_Z:
+									// Display a debug overlay of a hovered quadrant
+									{
+										vector2d position = camera -> screenToWorld(vector2d(mouseX, mouseY));
+										simulation -> post([position](simulationContainer& c) { c.select(position); });
+									}
+									break;
+								case SDLK_B:
+									// Switch to the next broadphase
+									simulation -> post([](simulationContainer& c) { c.switchBroadphase(); });
+									break;
+								case SDLK_T:
+									// Start recording a trace, or write the recorded one
+									if (!tracer::isRunning())
+									{
+										tracer::start();
+									}
+									else
+									{
+										tracer::stop();
+										tracer::dump("particles_trace.json");
+									}
+									break;
+								}
+							break;
+						case SDL_EVENT_WINDOW_RESIZED:
+							w = event.window.data1;
+	                		h = event.window.data2; 
+
+							window -> updateSize(w, h);
+							camera -> setSize(w, h);
+							break;
+						case SDL_EVENT_MOUSE_WHEEL:
+							if(event.wheel.y > 0)
+								particleSpawnCount += 1;
+							if(event.wheel.y < 0)
+								particleSpawnCount += (particleSpawnCount > 1) ? -1 : 0;
+							break;
+					}	
+				}
 			}
 			update();
-
-
-			tickCount++;
 		    
 			accumulator -= timeStep;
 		}
@@ -328,24 +461,41 @@ void manager::loop()
 	    fpsTimer += frameTime;
 	    if (fpsTimer >= 1.0)
 	    {
-	    	log::printAll();
 	        fps = frameCount;
 	        frameCount = 0;
 	        fpsTimer -= 1.0;
 	        displayFps = "fps: " + std::to_string(fps);
+	        view -> setStatus({displayFps, displayTps, displayParticleCount, displayBroadphase});
+
+	        for (int phase = 0; phase < int(timedPhase::count); ++phase)
+	        {
+	        	displayPhaseTimes[phase] = phaseTimers::getSummary(timedPhase(phase));
+	        }
+	        displaySolveThreads = phaseTimers::getThreadSummary();
 	    }
 
 	    tpsTimer += frameTime;
 	    if (tpsTimer >= 1.0)
 	    {
-	        tps = tickCount;
-	        tickCount = 0;
+	        tps = simulation -> takeTickCount();
 	        tpsTimer -= 1.0;
 	        displayTps = "tps: " + std::to_string(tps);
+
+	        // Heap allocations are only known when the global operator new is counted
+	        long long tickAllocations = simulation -> takeTickAllocations();
+	        if (allocationStats::countsHeap())
+	        	displayAllocations = "allocs/tick: " + std::to_string((tps > 0) ? tickAllocations / tps : 0);
+	        else
+	        	displayAllocations = "allocs/tick: off";
 	    }
 
-	    displayParticleCount = "particles: " + std::to_string(container -> getParticleCount());
-		displaySimulationState = "running: " + std::string((container -> getRunning()) ? "true" : "false");
+	    // The simulation thread owns the simulation, its state is read from the snapshot
+	    const particleSnapshot& snapshot = container -> getSnapshot();
+	    displayParticleCount = "particles: " + std::to_string(snapshot.x.size());
+		displaySimulationState = "running: " + std::string(snapshot.running ? "true" : "false");
+		displayBroadphase = "broadphase: " + snapshot.broadphaseName;
+		displayThreads = "threads: " + snapshot.schedulerName;
+		displayEnergy = fmt::format("energy: {:.4g}", snapshot.stats.kineticEnergy);
 
         if(fpsCap > 0)
 		{
@@ -368,6 +518,12 @@ void manager::cleanUp()
 	delete debugMenu;
 	delete controlsMenu;
 	
+	view -> stop();
+	delete view;
+
+	simulation -> stop();
+	delete simulation;
+	delete renderer;
 	container -> cleanUp();
 	delete container;
 
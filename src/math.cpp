@@ -54,17 +54,6 @@ double isqrt(double target)
     return static_cast<double>(y);
 }
 
-SDL_Color interpolateColor(const SDL_Color& color1, const SDL_Color& color2, double factor)
-{
-    factor = std::max(0.0, std::min(1.0, factor));
-    SDL_Color result;
-    result.r = static_cast<Uint8>(color1.r + (color2.r - color1.r) * factor);
-    result.g = static_cast<Uint8>(color1.g + (color2.g - color1.g) * factor);
-    result.b = static_cast<Uint8>(color1.b + (color2.b - color1.b) * factor);
-    result.a = static_cast<Uint8>(color1.a + (color2.a - color1.a) * factor);
-    return result;
-}
-
 double interpolateDouble(double value1, double value2, double factor)
 {
     factor = std::max(0.0, std::min(1.0, factor));
@@ -0,0 +1,114 @@
+#include "morton.hpp"
+
+#include <algorithm>
+
+uint32_t mortonKey(double x, double y, double halfDimension)
+{
+	double scale = 65536 / (halfDimension * 2);
+	double cellX = std::clamp((x + halfDimension) * scale, 0.0, 65535.0);
+	double cellY = std::clamp((y + halfDimension) * scale, 0.0, 65535.0);
+	return mortonEncode(uint32_t(cellX), uint32_t(cellY));
+}
+
+// Least significant digit radix sort, four passes of eight bits
+void radixSort(std::vector<uint32_t>& keys, std::vector<int>& values, std::vector<uint32_t>& keyScratch, std::vector<int>& valueScratch)
+{
+	size_t count = keys.size();
+	keyScratch.resize(count);
+	valueScratch.resize(count);
+
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		size_t offsets[257] = {};
+		for (size_t i = 0; i < count; ++i)
+		{
+			offsets[((keys[i] >> shift) & 0xff) + 1]++;
+		}
+		for (int digit = 0; digit < 256; ++digit)
+		{
+			offsets[digit + 1] += offsets[digit];
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			size_t target = offsets[(keys[i] >> shift) & 0xff]++;
+			keyScratch[target] = keys[i];
+			valueScratch[target] = values[i];
+		}
+		keys.swap(keyScratch);
+		values.swap(valueScratch);
+	}
+}
+
+// Each pass counts the digits of every chunk, then scatters every chunk to its own offsets
+// Offsets are laid out digit by digit and chunk by chunk within a digit, which keeps the sort stable
+void parallelRadixSort(std::vector<uint32_t>& keys, std::vector<int>& values, std::vector<uint32_t>& keyScratch, std::vector<int>& valueScratch, taskScheduler* scheduler, int chunkCount)
+{
+	size_t count = keys.size();
+	if (scheduler == nullptr || chunkCount <= 1 || count < 65536)
+	{
+		radixSort(keys, values, keyScratch, valueScratch);
+		return;
+	}
+
+	keyScratch.resize(count);
+	valueScratch.resize(count);
+
+	size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+	std::vector<size_t> offsets(size_t(chunkCount) * 256);
+
+	for (int shift = 0; shift < 32; shift += 8)
+	{
+		auto countDigits = [&](size_t c, size_t)
+		{
+			size_t* histogram = &offsets[c * 256];
+			std::fill(histogram, histogram + 256, 0);
+
+			size_t end = std::min(count, (c + 1) * chunkSize);
+			for (size_t i = c * chunkSize; i < end; ++i)
+			{
+				histogram[(keys[i] >> shift) & 0xff]++;
+			}
+		};
+
+		taskGroup counting;
+		for (int c = 0; c < chunkCount; ++c)
+		{
+			scheduler->submit(counting, countDigits, c, c + 1);
+		}
+		scheduler->wait(counting);
+
+		size_t total = 0;
+		for (int digit = 0; digit < 256; ++digit)
+		{
+			for (int c = 0; c < chunkCount; ++c)
+			{
+				size_t digitCount = offsets[size_t(c) * 256 + digit];
+				offsets[size_t(c) * 256 + digit] = total;
+				total += digitCount;
+			}
+		}
+
+		auto scatter = [&](size_t c, size_t)
+		{
+			size_t* offset = &offsets[c * 256];
+
+			size_t end = std::min(count, (c + 1) * chunkSize);
+			for (size_t i = c * chunkSize; i < end; ++i)
+			{
+				size_t target = offset[(keys[i] >> shift) & 0xff]++;
+				keyScratch[target] = keys[i];
+				valueScratch[target] = values[i];
+			}
+		};
+
+		taskGroup scattering;
+		for (int c = 0; c < chunkCount; ++c)
+		{
+			scheduler->submit(scattering, scatter, c, c + 1);
+		}
+		scheduler->wait(scattering);
+
+		keys.swap(keyScratch);
+		values.swap(valueScratch);
+	}
+}
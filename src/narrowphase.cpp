@@ -0,0 +1,158 @@
+#include "narrowphase.hpp"
+
+#include <bit>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define NARROWPHASE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// Compile a function for an instruction set without enabling it for the whole program
+#if defined(NARROWPHASE_X86) && defined(__GNUC__)
+#define NARROWPHASE_TARGET(name) __attribute__((target(name)))
+#else
+#define NARROWPHASE_TARGET(name)
+#endif
+
+simdLevel detectSimdLevel()
+{
+#if defined(NARROWPHASE_X86) && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return simdLevel::avx2;
+	if (__builtin_cpu_supports("sse4.2"))
+		return simdLevel::sse42;
+#elif defined(NARROWPHASE_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool sse42 = (info[2] & (1 << 20)) != 0;
+	bool osAvx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+
+	__cpuidex(info, 7, 0);
+	if (osAvx && (info[1] & (1 << 5)) != 0)
+		return simdLevel::avx2;
+	if (sse42)
+		return simdLevel::sse42;
+#endif
+	return simdLevel::scalar;
+}
+
+std::string getSimdLevelName(simdLevel level)
+{
+	switch (level)
+	{
+		case simdLevel::scalar:
+			return "scalar";
+		case simdLevel::sse42:
+			return "sse4.2";
+		case simdLevel::avx2:
+			return "avx2";
+	}
+	return "unknown";
+}
+
+// Same test as collide, written so that NaN coordinates count as touching there as well
+static int nextContactScalar(const particleStore& store, vector2d position, double radius, const int* candidates, int first, int last)
+{
+	for (int j = first; j < last; ++j)
+	{
+		int b = candidates[j];
+		double radiiSum = radius + store.radius[b];
+		if (!(std::abs(position.x - store.x[b]) >= radiiSum) && !(std::abs(position.y - store.y[b]) >= radiiSum))
+			return j;
+	}
+	return last;
+}
+
+#ifdef NARROWPHASE_X86
+
+// Test two candidates at a time
+NARROWPHASE_TARGET("sse4.2")
+static int nextContactSse42(const particleStore& store, vector2d position, double radius, const int* candidates, int first, int last)
+{
+	__m128d x = _mm_set1_pd(position.x);
+	__m128d y = _mm_set1_pd(position.y);
+	__m128d r = _mm_set1_pd(radius);
+	__m128d sign = _mm_set1_pd(-0.0);
+
+	int j = first;
+	for (; j + 2 <= last; j += 2)
+	{
+		int b0 = candidates[j];
+		int b1 = candidates[j + 1];
+		__m128d bx = _mm_set_pd(store.x[b1], store.x[b0]);
+		__m128d by = _mm_set_pd(store.y[b1], store.y[b0]);
+		__m128d radiiSum = _mm_add_pd(r, _mm_set_pd(store.radius[b1], store.radius[b0]));
+
+		__m128d dx = _mm_andnot_pd(sign, _mm_sub_pd(x, bx));
+		__m128d dy = _mm_andnot_pd(sign, _mm_sub_pd(y, by));
+		__m128d touching = _mm_and_pd(_mm_cmpnge_pd(dx, radiiSum), _mm_cmpnge_pd(dy, radiiSum));
+
+		int mask = _mm_movemask_pd(touching);
+		if (mask != 0)
+			return j + std::countr_zero(unsigned(mask));
+	}
+	return nextContactScalar(store, position, radius, candidates, j, last);
+}
+
+// Test four candidates at a time, gathering their coordinates
+NARROWPHASE_TARGET("avx2")
+static int nextContactAvx2(const particleStore& store, vector2d position, double radius, const int* candidates, int first, int last)
+{
+	__m256d x = _mm256_set1_pd(position.x);
+	__m256d y = _mm256_set1_pd(position.y);
+	__m256d r = _mm256_set1_pd(radius);
+	__m256d sign = _mm256_set1_pd(-0.0);
+
+	// Masked gathers with an explicit zero source, GCC builds the unmasked gather on an undefined source that -Wall reports as maybe uninitialized
+	__m256d zero = _mm256_setzero_pd();
+	__m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+	const double* storeX = store.x.data();
+	const double* storeY = store.y.data();
+	const double* storeRadius = store.radius.data();
+
+	int j = first;
+	for (; j + 4 <= last; j += 4)
+	{
+		__m128i index = _mm_loadu_si128(reinterpret_cast<const __m128i*>(candidates + j));
+		__m256d bx = _mm256_mask_i32gather_pd(zero, storeX, index, all, 8);
+		__m256d by = _mm256_mask_i32gather_pd(zero, storeY, index, all, 8);
+		__m256d radiiSum = _mm256_add_pd(r, _mm256_mask_i32gather_pd(zero, storeRadius, index, all, 8));
+
+		__m256d dx = _mm256_andnot_pd(sign, _mm256_sub_pd(x, bx));
+		__m256d dy = _mm256_andnot_pd(sign, _mm256_sub_pd(y, by));
+		__m256d touching = _mm256_and_pd(_mm256_cmp_pd(dx, radiiSum, _CMP_NGE_UQ), _mm256_cmp_pd(dy, radiiSum, _CMP_NGE_UQ));
+
+		int mask = _mm256_movemask_pd(touching);
+		if (mask != 0)
+			return j + std::countr_zero(unsigned(mask));
+	}
+
+	// The compiler turns the call below into a jump without clearing the upper halves,
+	// which would slow down every following SSE instruction of the caller
+	_mm256_zeroupper();
+	return nextContactScalar(store, position, radius, candidates, j, last);
+}
+
+#endif
+
+int nextContact(simdLevel level, const particleStore& store, vector2d position, double radius, const int* candidates, int first, int last)
+{
+#ifdef NARROWPHASE_X86
+	switch (level)
+	{
+		case simdLevel::avx2:
+			return nextContactAvx2(store, position, radius, candidates, first, last);
+		case simdLevel::sse42:
+			return nextContactSse42(store, position, radius, candidates, first, last);
+		case simdLevel::scalar:
+			break;
+	}
+#endif
+	return nextContactScalar(store, position, radius, candidates, first, last);
+}
@@ -0,0 +1,154 @@
+#include "particleStore.hpp"
+
+#include <algorithm>
+
+#include "allocationStats.hpp"
+#include "parallel.hpp"
+
+particleStore::particleStore()
+: layoutVersion(0), capacity(0)
+{}
+
+particleStore::particleStore(const particleStore& other)
+: layoutVersion(other.layoutVersion), capacity(0)
+{
+	copyColumns(other);
+}
+
+particleStore& particleStore::operator=(const particleStore& other)
+{
+	if (this != &other)
+	{
+		layoutVersion = other.layoutVersion;
+		copyColumns(other);
+	}
+	return *this;
+}
+
+// Copy the particles of another store, a copied column is only known to have room for the particles it holds
+void particleStore::copyColumns(const particleStore& other)
+{
+	x = other.x;
+	y = other.y;
+	vx = other.vx;
+	vy = other.vy;
+	ax = other.ax;
+	ay = other.ay;
+	radius = other.radius;
+	inverseMass = other.inverseMass;
+	capacity = int(other.x.size());
+}
+
+// Append a resting particle and return its index
+int particleStore::add(vector2d position, double nRadius, double density)
+{
+	// Grow every column by at least a whole slab at once, instead of letting each column reallocate on its own
+	if (getCount() >= capacity)
+		reserve(std::max(slabSize, getCount() * 2));
+
+	x.push_back(position.x);
+	y.push_back(position.y);
+	vx.push_back(0);
+	vy.push_back(0);
+	ax.push_back(0);
+	ay.push_back(0);
+	radius.push_back(nRadius);
+	inverseMass.push_back(1 / (3.14159265359 * nRadius * nRadius * density));
+
+	return getCount() - 1;
+}
+
+// Remove a particle, shifting every following particle down by one index
+// The columns keep their capacity, so the slot is reused by the next added particle
+void particleStore::erase(int index)
+{
+	x.erase(x.begin() + index);
+	y.erase(y.begin() + index);
+	vx.erase(vx.begin() + index);
+	vy.erase(vy.begin() + index);
+	ax.erase(ax.begin() + index);
+	ay.erase(ay.begin() + index);
+	radius.erase(radius.begin() + index);
+	inverseMass.erase(inverseMass.begin() + index);
+
+	layoutVersion++;
+}
+
+// Remove all particles
+void particleStore::clear()
+{
+	x.clear();
+	y.clear();
+	vx.clear();
+	vy.clear();
+	ax.clear();
+	ay.clear();
+	radius.clear();
+	inverseMass.clear();
+
+	layoutVersion++;
+}
+
+// Reserve space for a number of particles in every column
+void particleStore::reserve(int count)
+{
+	if (count <= capacity)
+		return;
+
+	allocationStats::storeGrowths.fetch_add(1, std::memory_order_relaxed);
+
+	x.reserve(count);
+	y.reserve(count);
+	vx.reserve(count);
+	vy.reserve(count);
+	ax.reserve(count);
+	ay.reserve(count);
+	radius.reserve(count);
+	inverseMass.reserve(count);
+	capacity = count;
+}
+
+// Gather a column in the given order, using scratch as the new storage
+// Scratch is reserved to the shared capacity first, so the column swapped in has as much room as the others
+// The gathers of disjoint ranges are independent, so with a scheduler they run in parallel
+static void gather(std::vector<double>& column, std::vector<double>& scratch, const std::vector<int>& order, int capacity, taskScheduler* scheduler)
+{
+	scratch.reserve(capacity);
+	scratch.resize(order.size());
+	if (scheduler == nullptr)
+	{
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			scratch[i] = column[order[i]];
+		}
+	}
+	else
+	{
+		parallelFor(*scheduler, partitionMode::staticChunks, order.size(),
+			[](size_t) { return 0; },
+			[&column, &scratch, &order](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+				{
+					scratch[i] = column[order[i]];
+				}
+			});
+	}
+	column.swap(scratch);
+}
+
+// Move the particles so that the particle at order[i] ends up at index i
+// Particles missing from order are removed, so an increasing order compacts the storage without moving the rest out of order
+void particleStore::reorder(const std::vector<int>& order, taskScheduler* scheduler)
+{
+	gather(x, scratch, order, capacity, scheduler);
+	gather(y, scratch, order, capacity, scheduler);
+	gather(vx, scratch, order, capacity, scheduler);
+	gather(vy, scratch, order, capacity, scheduler);
+	gather(ax, scratch, order, capacity, scheduler);
+	gather(ay, scratch, order, capacity, scheduler);
+	gather(radius, scratch, order, capacity, scheduler);
+	gather(inverseMass, scratch, order, capacity, scheduler);
+
+	layoutVersion++;
+}
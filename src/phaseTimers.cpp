@@ -0,0 +1,147 @@
+#include "phaseTimers.hpp"
+
+#include <algorithm>
+#include <fmt/format.h>
+
+std::array<phaseHistory, size_t(timedPhase::count)> phaseTimers::histories;
+std::array<phaseHistory, phaseTimers::maxThreads> phaseTimers::threadHistories;
+std::array<std::atomic<long long>, phaseTimers::maxThreads> phaseTimers::threadTime{};
+std::atomic<int> phaseTimers::threadCount(0);
+
+void phaseHistory::add(double milliseconds)
+{
+	std::lock_guard<std::mutex> lock(mtx);
+	samples[next] = float(milliseconds);
+	next = (next + 1) % capacity;
+	size = std::min(size + 1, capacity);
+}
+
+void phaseHistory::summarize(double& min, double& average, double& p99)
+{
+	std::array<float, capacity> sorted;
+	int count;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		count = size;
+		std::copy(samples.begin(), samples.begin() + count, sorted.begin());
+	}
+
+	min = 0;
+	average = 0;
+	p99 = 0;
+	if (count == 0)
+		return;
+
+	std::sort(sorted.begin(), sorted.begin() + count);
+	for (int i = 0; i < count; ++i)
+	{
+		average += sorted[i];
+	}
+	average /= count;
+	min = sorted[0];
+	p99 = sorted[std::min(count - 1, count * 99 / 100)];
+}
+
+void phaseTimers::record(timedPhase phase, double milliseconds)
+{
+	histories[size_t(phase)].add(milliseconds);
+}
+
+// Index of the calling thread among the threads that solved leaves, -1 once all slots are taken
+int phaseTimers::getThreadIndex()
+{
+	thread_local int index = -2;
+	if (index == -2)
+	{
+		index = threadCount.fetch_add(1, std::memory_order_relaxed);
+		if (index >= maxThreads)
+			index = -1;
+	}
+	return index;
+}
+
+void phaseTimers::addThreadTime(double milliseconds)
+{
+	int index = getThreadIndex();
+	if (index >= 0)
+		threadTime[index].fetch_add((long long)(milliseconds * 1e6), std::memory_order_relaxed);
+}
+
+void phaseTimers::finishTick()
+{
+	int count = std::min(threadCount.load(std::memory_order_relaxed), maxThreads);
+	for (int t = 0; t < count; ++t)
+	{
+		long long nanoseconds = threadTime[t].exchange(0, std::memory_order_relaxed);
+		threadHistories[t].add(nanoseconds * 1e-6);
+	}
+}
+
+std::string phaseTimers::getSummary(timedPhase phase)
+{
+	if (!enabled())
+		return fmt::format("{}: off", getName(phase));
+
+	double min, average, p99;
+	histories[size_t(phase)].summarize(min, average, p99);
+	return fmt::format("{}: {:.2f}/{:.2f}/{:.2f}", getName(phase), min, average, p99);
+}
+
+std::string phaseTimers::getThreadSummary()
+{
+	if (!enabled())
+		return "solve/thread: off";
+
+	std::string summary = "solve/thread:";
+	int count = std::min(threadCount.load(std::memory_order_relaxed), maxThreads);
+	for (int t = 0; t < count; ++t)
+	{
+		double min, average, p99;
+		threadHistories[t].summarize(min, average, p99);
+
+		// Threads of a replaced scheduler fade out once their window only holds idle ticks
+		if (average > 0)
+			summary += fmt::format(" {:.2f}", average);
+	}
+	return summary;
+}
+
+const char* phaseTimers::getName(timedPhase phase)
+{
+	switch (phase)
+	{
+		case timedPhase::integrate:
+			return "integrate";
+		case timedPhase::rebuild:
+			return "rebuild";
+		case timedPhase::split:
+			return "split";
+		case timedPhase::solve:
+			return "solve";
+		case timedPhase::events:
+			return "events";
+		case timedPhase::renderGrid:
+			return "grid";
+		case timedPhase::renderParticles:
+			return "particles";
+		case timedPhase::renderBroadphase:
+			return "leaves";
+		case timedPhase::renderMenus:
+			return "menus";
+		case timedPhase::display:
+			return "display";
+		case timedPhase::count:
+			break;
+	}
+	return "unknown";
+}
+
+// Check if the scoped timers were compiled in
+bool phaseTimers::enabled()
+{
+#ifdef PARTICLES_PHASE_TIMERS
+	return true;
+#else
+	return false;
+#endif
+}
@@ -1,5 +1,7 @@
 #include "quadTree.hpp"
 
+#include "allocationStats.hpp"
+
 quadTreeBox::quadTreeBox()
 {}
 
@@ -7,8 +9,8 @@ quadTreeBox::quadTreeBox(vector2d nCenter, double nHalfDimension)
 :center(nCenter), halfDimension(nHalfDimension)
 {}
 
-quadTree::quadTree(quadTreeBox nBoundary, int nCapacity)
-:boundary(nBoundary), capacity(nCapacity)
+quadTree::quadTree(quadTreeBox nBoundary, int nCapacity, quadTree* nParent)
+:boundary(nBoundary), capacity(nCapacity), homeCount(0), parent(nParent)
 {
 	nw = nullptr;
 	ne = nullptr;
@@ -16,13 +18,9 @@ quadTree::quadTree(quadTreeBox nBoundary, int nCapacity)
 	se = nullptr;
 }
 
-// Split the quadtree into four quadrants
-void quadTree::split()
+// Split the quadrant into four quadrants and move its particles into them
+void quadTree::split(particleStore& store, quadTreeHomes& homes, quadTreePool& pool)
 {
-	// Check if splitting is necessary
-	if((int(particles.size()) <= capacity) || (boundary.halfDimension/2 <= 2))
-		return;
-
 	// Define the boundaries of the quadrants
 	quadTreeBox nBoundary;
 	nBoundary.halfDimension = boundary.halfDimension / 2;
@@ -30,138 +28,127 @@ void quadTree::split()
 	// Northwest quadrant
 	nBoundary.center.x = boundary.center.x - (boundary.halfDimension / 2);
 	nBoundary.center.y = boundary.center.y - (boundary.halfDimension / 2);
-	nw = new quadTree(nBoundary, capacity);
+	nw = pool.acquire(nBoundary, this);
 
 	// Southwest quadrant
 	nBoundary.center.y = boundary.center.y + (boundary.halfDimension / 2);
-	sw = new quadTree(nBoundary, capacity);
+	sw = pool.acquire(nBoundary, this);
 
 	// Southeast quadrant
 	nBoundary.center.x = boundary.center.x + (boundary.halfDimension / 2);
-	se = new quadTree(nBoundary, capacity);
+	se = pool.acquire(nBoundary, this);
 
 	// Northeast quadrant
 	nBoundary.center.x = boundary.center.x + (boundary.halfDimension / 2);
 	nBoundary.center.y = boundary.center.y - (boundary.halfDimension / 2);
-	ne = new quadTree(nBoundary, capacity);
-
-	
+	ne = pool.acquire(nBoundary, this);
 
 	// Distribute particles among the quadrants
-	for (particle* p : particles)
+	for (int p : particles)
 	{
-		vector2d position = p -> getPosition();
-		double radius = p -> getRadius();
-		
-		if(position.x >= (boundary.center.x - radius * 2))
-		{
-			if(position.y >= (boundary.center.y - radius * 2))
-				se -> particles.push_back(p);
-
-			if(position.y <= (boundary.center.y + radius * 2))
-				ne -> particles.push_back(p);
-		}
-		if(position.x <= (boundary.center.x + radius * 2))
-		{
-			if(position.y >= (boundary.center.y - radius * 2))
-				sw -> particles.push_back(p);
-
-			if(position.y <= (boundary.center.y + radius * 2))
-				nw -> particles.push_back(p);
-		}
+		vector2d position = {store.x[p], store.y[p]};
+		getChild(position) -> insertParticle(p, position, homes);
 	}
 
 	// Clear particles from this quadrant
 	particles.clear();
-	particles.shrink_to_fit();
-
-	// Split the child quadrants recursively
-	nw -> split();
-	ne -> split();
-	sw -> split();
-	se -> split();
+	homeCount = 0;
 }
 
-// Render the quadtree
-void quadTree::render(aCamera* camera, vector2d mouse)
+// Collapse the four leaf children back into this quadrant
+void quadTree::merge(quadTreeHomes& homes, quadTreePool& pool)
 {
-	if(nw != nullptr)
+	for (quadTree* child : {nw, ne, sw, se})
 	{
-		nw -> render(camera, mouse);
-		ne -> render(camera, mouse);
-		sw -> render(camera, mouse);
-		se -> render(camera, mouse);
-		return;
+		for (int p : child -> particles)
+		{
+			homes.leaf[p] = this;
+			homes.slot[p] = homeCount;
+			particles.push_back(p);
+			homeCount++;
+		}
+		pool.release(child);
 	}
 
-	// Draw the boundary of the quadrant
-	vector2d pos = {boundary.center.x - boundary.halfDimension, boundary.center.y - boundary.halfDimension};
-	vector2d size = {boundary.halfDimension * 2, boundary.halfDimension * 2};
-	SDL_Color color = {0, 128, 255, 16};
+	nw = nullptr;
+	ne = nullptr;
+	sw = nullptr;
+	se = nullptr;
+}
+
+// Lazily split leaves over capacity and merge quadrants that became sparse
+// Merging only below half the capacity keeps quadrants from flickering between states
+void quadTree::restructure(particleStore& store, quadTreeHomes& homes, quadTreePool& pool)
+{
+	if (nw == nullptr)
+	{
+		// Check if splitting is necessary
+		if ((homeCount <= capacity) || (boundary.halfDimension/2 <= 2))
+			return;
 
-	mouse = camera -> screenToWorld(mouse);
-	if(mouse.x < pos.x+size.x && mouse.x > pos.x && mouse.y < pos.y+size.y && mouse.y > pos.y && nw == nullptr)
-		color = {255, 0, 0, 16};
+		split(store, homes, pool);
+	}
 
-	SDL_FRect rect = {float(pos.x), float(pos.y), float(size.x), float(size.y)};
-	camera -> renderRect(rect, color, false);
+	nw -> restructure(store, homes, pool);
+	ne -> restructure(store, homes, pool);
+	sw -> restructure(store, homes, pool);
+	se -> restructure(store, homes, pool);
 
-	// Draw the lines of the quadrant
-	color.a += 32;
-	vector2d a = {boundary.center.x - boundary.halfDimension + 0.2, boundary.center.y - boundary.halfDimension + 0.2};
-	vector2d b = {boundary.center.x - boundary.halfDimension + 0.2, boundary.center.y + boundary.halfDimension - 0.2};
-	camera -> renderLine(a, b, 2, color, false);
+	if (nw -> nw != nullptr || ne -> nw != nullptr || sw -> nw != nullptr || se -> nw != nullptr)
+		return;
 
-	a = {boundary.center.x + boundary.halfDimension - 0.2, boundary.center.y + boundary.halfDimension - 0.2};
-	b = {boundary.center.x + boundary.halfDimension - 0.2, boundary.center.y - boundary.halfDimension + 0.2};
-	camera -> renderLine(a, b, 2, color, false);
+	if (nw -> homeCount + ne -> homeCount + sw -> homeCount + se -> homeCount <= capacity / 2)
+		merge(homes, pool);
+}
 
-	a = {boundary.center.x - boundary.halfDimension + 0.2, boundary.center.y - boundary.halfDimension + 0.2};
-	b = {boundary.center.x + boundary.halfDimension - 0.2, boundary.center.y - boundary.halfDimension + 0.2};
-	camera -> renderLine(a, b, 2, color, false);
 
+// Insert a particle into the leaf containing its center
+// Must only be called while the leaves hold no ghosts
+void quadTree::insertParticle(int index, vector2d position, quadTreeHomes& homes)
+{
+	quadTree* leaf = this;
+	while (leaf -> nw != nullptr)
+	{
+		leaf = leaf -> getChild(position);
+	}
 
-	a = {boundary.center.x + boundary.halfDimension - 0.2, boundary.center.y + boundary.halfDimension - 0.2};
-	b = {boundary.center.x - boundary.halfDimension + 0.2, boundary.center.y + boundary.halfDimension - 0.2};
-	camera -> renderLine(a, b, 2, color, false);
+	homes.leaf[index] = leaf;
+	homes.slot[index] = leaf -> homeCount;
+	leaf -> particles.push_back(index);
+	leaf -> homeCount++;
 }
 
-// Insert a particle into the quadtree
-void quadTree::insertParticle(particle* p)
+// Remove a particle from this leaf by moving the last particle into its slot
+// Must only be called while the leaves hold no ghosts
+void quadTree::removeParticle(int index, quadTreeHomes& homes)
 {
-	particles.push_back(p);
+	int slot = homes.slot[index];
+	int last = particles[homeCount - 1];
+
+	particles[slot] = last;
+	homes.slot[last] = slot;
+
+	particles.pop_back();
+	homeCount--;
 }
 
-// Clear the whole quadtree and deallocate memory
-void quadTree::clear()
+// Add a particle as a ghost to every leaf, other than its home, overlapped by its bounds
+void quadTree::insertGhost(int index, quadTreeBox bounds, quadTree* home)
 {
-	if (nw)
+	if (!boundary.overlaps(bounds))
+		return;
+
+	if (nw == nullptr)
 	{
-        nw->clear();
-        delete nw;
-        nw = nullptr;
-    }
-
-    if (ne)
-    {
-        ne->clear();
-        delete ne;
-        ne = nullptr;
-    }
-
-    if (sw)
-    {
-        sw->clear();
-        delete sw;
-        sw = nullptr;
-    }
-
-    if (se)
-    {
-        se->clear();
-        delete se;
-        se = nullptr;
-    }
+		if (this != home)
+			particles.push_back(index);
+		return;
+	}
+
+	nw -> insertGhost(index, bounds, home);
+	ne -> insertGhost(index, bounds, home);
+	sw -> insertGhost(index, bounds, home);
+	se -> insertGhost(index, bounds, home);
 }
 
 // Retrieve all leaves of the quadtree
@@ -178,4 +165,66 @@ void quadTree::getLeaves(std::vector<quadTree*>& quads)
 		sw -> getLeaves(quads);
 		se -> getLeaves(quads);
 	}
+}
+
+quadTreePool::quadTreePool(int nCapacity)
+:capacity(nCapacity), blockIndex(0), blockUsed(0)
+{}
+
+// Hand out a leaf node, recycling released nodes before touching fresh ones
+quadTree* quadTreePool::acquire(quadTreeBox boundary, quadTree* parent)
+{
+	quadTree* node = nullptr;
+	if (!freeNodes.empty())
+	{
+		node = freeNodes.back();
+		freeNodes.pop_back();
+	}
+	else
+	{
+		if (blockIndex < int(blocks.size()) && blockUsed == blockSize)
+		{
+			blockIndex++;
+			blockUsed = 0;
+		}
+
+		// Blocks never grow past their reserved size, so handed out nodes never move
+		if (blockIndex == int(blocks.size()))
+		{
+			blocks.emplace_back();
+			blocks.back().reserve(blockSize);
+			allocationStats::nodeBlocks.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		std::vector<quadTree>& block = blocks[blockIndex];
+		if (blockUsed == int(block.size()))
+			block.emplace_back(boundary, capacity, parent);
+
+		node = &block[blockUsed];
+		blockUsed++;
+	}
+
+	node -> boundary = boundary;
+	node -> parent = parent;
+	node -> nw = nullptr;
+	node -> ne = nullptr;
+	node -> sw = nullptr;
+	node -> se = nullptr;
+	node -> particles.clear();
+	node -> homeCount = 0;
+	return node;
+}
+
+// Return a node to the pool, its children must have been released already
+void quadTreePool::release(quadTree* node)
+{
+	freeNodes.push_back(node);
+}
+
+// Release every node at once, the blocks are kept for the next tree
+void quadTreePool::reset()
+{
+	blockIndex = 0;
+	blockUsed = 0;
+	freeNodes.clear();
 }
\ No newline at end of file
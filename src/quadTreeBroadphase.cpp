@@ -0,0 +1,122 @@
+#include "quadTreeBroadphase.hpp"
+
+#include "phaseTimers.hpp"
+
+quadTreeBroadphase::quadTreeBroadphase(double nHalfDimension, int nCapacity)
+:halfDimension(nHalfDimension), capacity(nCapacity), pool(nCapacity), root(nullptr), trackedCount(0), trackedLayout(-1)
+{
+	reset();
+}
+
+quadTreeBroadphase::~quadTreeBroadphase()
+{
+	clear();
+}
+
+// Bring the quadtree up to date with the current particle positions
+void quadTreeBroadphase::build(particleStore& store)
+{
+	// Indices are stale once particles were removed or reordered
+	if (store.layoutVersion != trackedLayout)
+	{
+		reset();
+		trackedLayout = store.layoutVersion;
+	}
+
+	int count = store.getCount();
+
+	// Drop the ghosts of the previous build
+	for (quadTree* q : quads)
+	{
+		q->particles.resize(q->homeCount);
+	}
+
+	homes.leaf.resize(count);
+	homes.slot.resize(count);
+
+	// Move particles whose center left their leaf, starting from the closest ancestor containing them
+	for (int i = 0; i < trackedCount; ++i)
+	{
+		vector2d position = {store.x[i], store.y[i]};
+		quadTree* home = homes.leaf[i];
+		if (home->boundary.contains(position))
+			continue;
+
+		home->removeParticle(i, homes);
+
+		quadTree* node = home;
+		while (node->parent != nullptr && !node->boundary.contains(position))
+		{
+			node = node->parent;
+		}
+		node->insertParticle(i, position, homes);
+	}
+
+	// Insert the particles added since the last build
+	for (int i = trackedCount; i < count; ++i)
+	{
+		root->insertParticle(i, {store.x[i], store.y[i]}, homes);
+	}
+	trackedCount = count;
+
+	{
+		TIME_PHASE(timedPhase::split);
+		root->restructure(store, homes, pool);
+	}
+
+	// Add particles near the edge of their leaf as ghosts to the neighbouring leaves
+	for (int i = 0; i < count; ++i)
+	{
+		quadTreeBox bounds({store.x[i], store.y[i]}, store.radius[i] * 2);
+		quadTree* home = homes.leaf[i];
+		if (home->boundary.covers(bounds))
+			continue;
+
+		quadTree* node = home;
+		while (node->parent != nullptr && !node->boundary.covers(bounds))
+		{
+			node = node->parent;
+		}
+		node->insertGhost(i, bounds, home);
+	}
+
+	quads.clear();
+	root->getLeaves(quads);
+}
+
+// Retrieve all non-empty leaves of the quadtree
+void quadTreeBroadphase::getLeaves(std::vector<broadphaseLeaf>& leaves)
+{
+	for (quadTree* q : quads)
+	{
+		if (q->particles.empty())
+			continue;
+
+		leaves.push_back({q->boundary, q->particles.data(), int(q->particles.size()), q->homeCount});
+	}
+}
+
+// Drop the whole quadtree, its nodes stay in the pool for reuse
+void quadTreeBroadphase::clear()
+{
+	quads.clear();
+	homes.leaf.clear();
+	homes.slot.clear();
+	trackedCount = 0;
+
+	pool.reset();
+	root = nullptr;
+}
+
+// Start over with an empty root
+void quadTreeBroadphase::reset()
+{
+	clear();
+	root = pool.acquire({vector2d(0, 0), halfDimension}, nullptr);
+	root->getLeaves(quads);
+}
+
+std::string quadTreeBroadphase::getName()
+{
+	return "quadTree";
+}
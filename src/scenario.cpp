@@ -0,0 +1,183 @@
+#include "scenario.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+#include "log.hpp"
+#include "simulation.hpp"
+
+scenario::scenario()
+: ticks(600), iterationSteps(0), broadphase(broadphaseType::quadTree)
+{}
+
+// Split a scenario file into words and braces, like the menu parser
+static bool tokenize(const std::string& filePath, std::vector<std::string>& tokens)
+{
+	std::ifstream file(filePath);
+	if (!file.is_open())
+		return false;
+
+	std::string token;
+	char c;
+	while (file.get(c))
+	{
+		if (std::isspace(static_cast<unsigned char>(c)))
+			continue;
+		if (c == '{' || c == '}')
+		{
+			if (!token.empty())
+				tokens.push_back(token);
+			tokens.push_back(std::string() + c);
+			token.clear();
+			continue;
+		}
+		token += c;
+	}
+	if (!token.empty())
+		tokens.push_back(token);
+	return true;
+}
+
+// Read comma separated numbers, returns false unless there are exactly as many as expected
+static bool parseNumbers(const std::string& value, std::vector<double>& numbers, size_t expected)
+{
+	numbers.clear();
+	size_t start = 0;
+	while (start <= value.size())
+	{
+		size_t end = value.find(',', start);
+		if (end == std::string::npos)
+			end = value.size();
+
+		double number;
+		if (sscanf(value.substr(start, end - start).c_str(), "%lf", &number) != 1)
+			return false;
+		numbers.push_back(number);
+		start = end + 1;
+	}
+	return numbers.size() == expected;
+}
+
+bool scenario::load(const std::string& filePath)
+{
+	std::vector<std::string> tokens;
+	if (!tokenize(filePath, tokens))
+	{
+		log::error("scenario::load - Could not open file {}", filePath);
+		return false;
+	}
+
+	if (tokens.size() < 3 || tokens[0] != "scenario" || tokens[1] != "{" || tokens.back() != "}")
+	{
+		log::error("scenario::load - In file \"{}\", expected a scenario{{}} block", filePath);
+		return false;
+	}
+
+	std::mt19937 random(1234);
+	std::vector<double> numbers;
+	particles.clear();
+
+	for (size_t pos = 2; pos + 1 < tokens.size(); pos += 4)
+	{
+		if (pos + 3 >= tokens.size() || tokens[pos + 1] != "{" || tokens[pos + 3] != "}")
+		{
+			log::error("scenario::load - In file \"{}\" at token index \"{}\", expected key{{value}} but found \"{}\"", filePath, pos, tokens[pos]);
+			return false;
+		}
+
+		const std::string& key = tokens[pos];
+		const std::string& value = tokens[pos + 2];
+		bool valid = true;
+		if (key == "ticks")
+		{
+			valid = parseNumbers(value, numbers, 1);
+			if (valid)
+				ticks = int(numbers[0]);
+		}
+		else if (key == "seed")
+		{
+			valid = parseNumbers(value, numbers, 1);
+			if (valid)
+				random.seed(unsigned(numbers[0]));
+		}
+		else if (key == "broadphase")
+		{
+			valid = findBroadphaseType(value, broadphase);
+		}
+		else if (key == "iterationSteps")
+		{
+			valid = parseNumbers(value, numbers, 1);
+			if (valid)
+				iterationSteps = int(numbers[0]);
+		}
+		else if (key == "grid")
+		{
+			valid = parseNumbers(value, numbers, 3);
+			if (valid)
+			{
+				int count = int(numbers[0]);
+				int side = int(std::ceil(std::sqrt(double(count))));
+				std::uniform_real_distribution<double> jitter(-1, 1);
+				particles.reserve(particles.getCount() + count);
+				for (int i = 0; i < count; ++i)
+				{
+					vector2d position = {(i % side - side / 2) * numbers[2] + jitter(random), (i / side - side / 2) * numbers[2] + jitter(random)};
+					particles.add(position, numbers[1], 1);
+				}
+			}
+		}
+		else if (key == "cluster")
+		{
+			valid = parseNumbers(value, numbers, 5);
+			if (valid)
+			{
+				int count = int(numbers[2]);
+				std::normal_distribution<double> spread(0, numbers[4]);
+				particles.reserve(particles.getCount() + count);
+				for (int i = 0; i < count; ++i)
+				{
+					particles.add({numbers[0] + spread(random), numbers[1] + spread(random)}, numbers[3], 1);
+				}
+			}
+		}
+		else if (key == "particle")
+		{
+			valid = parseNumbers(value, numbers, 5);
+			if (valid)
+			{
+				int index = particles.add({numbers[0], numbers[1]}, numbers[2], 1);
+				particles.vx[index] = numbers[3];
+				particles.vy[index] = numbers[4];
+			}
+		}
+		else
+		{
+			log::error("scenario::load - In file \"{}\", unknown key \"{}\"", filePath, key);
+			return false;
+		}
+
+		if (!valid)
+		{
+			log::error("scenario::load - In file \"{}\", invalid value \"{}\" for key \"{}\"", filePath, value, key);
+			return false;
+		}
+	}
+
+	log::info("scenario::load - Loaded {} particles for {} ticks from {}", particles.getCount(), ticks, filePath);
+	return true;
+}
+
+void scenario::apply(simulationContainer& container)
+{
+	container.setBroadphase(broadphase);
+	if (iterationSteps > 0)
+		container.setIterationSteps(iterationSteps);
+
+	for (int i = 0; i < particles.getCount(); ++i)
+	{
+		container.addParticle({particles.x[i], particles.y[i]}, particles.radius[i]);
+		container.getParticle(container.getParticleCount() - 1).setVelocity({particles.vx[i], particles.vy[i]});
+	}
+}
@@ -1,9 +1,20 @@
 #include "simulation.hpp"
 
+#include <atomic>
+#include <bit>
+#include <chrono>
+
+#include "log.hpp"
+#include "phaseTimers.hpp"
+#include "trace.hpp"
+
+// Number of colors available to colorLeaves, leaves that find no free color are solved serially
+static const int maxColors = 64;
+
 // Constructor for the simulation container
-simulationContainer::simulationContainer()
+simulationContainer::simulationContainer(const schedulerSettings& settings)
 {
-	pool = new ThreadPool(12);
+	scheduler = new taskScheduler(settings); // Worker threads solving the leaves
 
 	density = 1; // Universal density of each particle
 
@@ -21,7 +32,11 @@ simulationContainer::simulationContainer()
 
 	nodeHalfDimension = 8192; // Half dimension of the simulation space
 
-	nodeQuadTree = new quadTree({vector2d(0, 0), nodeHalfDimension}, quadrantCapacity);	// Root of the quadtree system
+	cellSize = 20; // Minimum cell size of the cellGrid broadphase
+
+	nodeBroadphaseType = broadphaseType::quadTree; // Spatial structure used to find collision candidates
+
+	nodeBroadphase = createBroadphase(nodeBroadphaseType, nodeHalfDimension, quadrantCapacity, cellSize);
 
 	isPlacingParticle = false; // Flag for placing a particle
 
@@ -31,173 +46,561 @@ simulationContainer::simulationContainer()
 
 	particleCount = 0; // Total number of particles currently being simulated
 
-	selectedQuadTree = nullptr; // Currently selected quadrant of the QuadTree, for debugging
+	selectedParticles.clear(); // Particles of the currently selected leaf, for debugging
 
 	iterationSteps = 2; // Number of iteration steps for collision resolution
 
+	reordering = true; // Flag to keep the particle storage in Z-order
+
+	reorderInterval = 32; // Number of ticks between disorder checks
+
+	reorderThreshold = 0.1; // Fraction of out of order neighbours that triggers a reorder
+
+	ticksSinceReorder = 0; // Ticks since the last disorder check
+
+	execution = executionMode::graph; // Passes of a tick run as a task graph, overlapping the render list with the solver
+
+	frameGraphSteps = -1; // Iteration steps the frame graph was built for, -1 before it was built
+
+	previousLayoutVersion = -1; // Layout of the particle storage when previousX and previousY were taken
+
+	lastTickTime = 0; // Steady clock seconds of the last published snapshot
+
+	stats = {0, 0, 0, 0}; // Statistics of the last tick
+
+	tickPairTests = 0; // Candidate pairs tested so far in the current tick
+
+	solver = solverMode::colored; // Race free distribution of the leaves over the scheduler
+
+	partition = partitionMode::guided; // Chunking of the leaves by their estimated cost
+
+	halfPairs = true; // Flag to solve every pair once instead of once per ordering
+
+	supportedSimdLevel = detectSimdLevel(); // Best instruction set of this CPU
+
+	narrowphaseLevel = supportedSimdLevel; // Instruction set used to find contacts in the half-pair kernel
+
+	log::info("simulationContainer::simulationContainer - Narrow phase uses '{}'", ::getSimdLevelName(narrowphaseLevel));
 	log::info("simulationContainer::simulationContainer - Constructor finished successfully.");
 }
 
 void simulationContainer::cleanUp()
 {
-	delete pool;
-	nodeQuadTree -> clear();
-	delete nodeQuadTree;
-	for (particle* p : particles) {
-		delete p;
-	}
+	delete scheduler;
+	delete nodeBroadphase;
 	particles.clear();
 }
 
 // Update the simulation state
 void simulationContainer::update()
 {
-	// Update particles' positions and velocities
-	for (auto& p : particles)
+	// Periodically restore the Z-order of the particle storage
+	ticksSinceReorder++;
+	if (reordering && ticksSinceReorder >= reorderInterval)
 	{
-		// Calculate friction forces
-		double frictionX = (p -> getVelocity().x > 0) ? -friction : friction;
-		double frictionY = (p -> getVelocity().y > 0) ? -friction : friction;
+		ticksSinceReorder = 0;
+		if (getDisorder() > reorderThreshold)
+			reorderParticles();
+	}
+	tickPairTests = 0;
 
-		// Update velocities with accelerations
-		p -> setVelocity(p -> getVelocity() + p -> getAcceleration());
+	if (execution == executionMode::graph)
+	{
+		updateGraph();
+		phaseTimers::finishTick();
+		return;
+	}
 
-		// Update positions based on velocities
-		p -> setPosition(p -> getPosition() + p -> getVelocity());
+	if (execution == executionMode::phased)
+	{
+		updatePhases();
+	}
+	else
+	{
+		integrate();
+		for (int i = 0; i < iterationSteps; ++i)
+		{
+			selectedParticles.clear();
 
-		// Apply friction force
-		p -> setVelocity({p -> getVelocity().x + frictionX, p -> getVelocity().y + frictionY});
+			removeOutOfBounds();
+
+			solveCollisions();
+		}
 	}
+	phaseTimers::finishTick();
+	updateStats();
+	publishSnapshot();
+}
+
+// Update the simulation state by running the frame graph
+void simulationContainer::updateGraph()
+{
+	if (frameGraphSteps != iterationSteps)
+		buildFrameGraph();
+
+	frameGraph.run(*scheduler);
+
+	// The statistics were gathered alongside the snapshot
+	snapshots.getWriteBuffer().stats = stats;
+	snapshots.publish();
+}
+
+// Declare the passes of a tick and their dependencies
+// The iterations form a chain after the integration, every pass reads what the one before wrote, removal compacts
+// the store that the broadphase is built from and the solve moves the particles the next removal checks
+// Only the statistics and the snapshot are independent, they are gathered alongside each other at the end
+void simulationContainer::buildFrameGraph()
+{
+	frameGraph.clear();
+	frameGraphSteps = iterationSteps;
+
+	int previous = frameGraph.addNode("integrate", [this]() { integrate(); });
 	for (int i = 0; i < iterationSteps; ++i)
 	{
-		selectedQuadTree = nullptr;
-		nodeQuadTree->clear();
-		delete nodeQuadTree;
-		nodeQuadTree = new quadTree({vector2d(0, 0), nodeHalfDimension}, quadrantCapacity);
-
-		//Insert particles into the quadtree
-		for (size_t i = particles.size(); i > 0; --i)
+		int remove = frameGraph.addNode("removeOutOfBounds", [this]()
 		{
-		    size_t index = i - 1;
-		    if (particles[index]->getPosition().x > nodeHalfDimension ||
-		        particles[index]->getPosition().x < -nodeHalfDimension ||
-		        particles[index]->getPosition().y > nodeHalfDimension ||
-		        particles[index]->getPosition().y < -nodeHalfDimension)
-		    {
-		        delete particles[index];
-		        particles.erase(particles.begin() + index);
-		    }
-		    else
-		    {
-		    	nodeQuadTree->insertParticle(particles[index]);
-		    }
-		}
+			selectedParticles.clear();
+			removeOutOfBounds();
+		});
+		int build = frameGraph.addNode("broadphase", [this]() { prepareLeaves(); });
+		int solve = frameGraph.addNode("solve", [this]() { solvePreparedLeaves(); });
+
+		frameGraph.addDependency(previous, remove);
+		frameGraph.addDependency(remove, build);
+		frameGraph.addDependency(build, solve);
+		previous = solve;
+	}
 
-		nodeQuadTree->split();
+	int statsNode = frameGraph.addNode("stats", [this]() { updateStats(); });
+	int snapshotNode = frameGraph.addNode("snapshot", [this]() { captureSnapshot(snapshots.getWriteBuffer()); });
+	frameGraph.addDependency(previous, statsNode);
+	frameGraph.addDependency(previous, snapshotNode);
+}
 
-		std::vector<quadTree*> quads;
-		nodeQuadTree->getLeaves(quads);
+// Publish the current state to the render thread
+void simulationContainer::publishSnapshot()
+{
+	captureSnapshot(snapshots.getWriteBuffer());
+	snapshots.getWriteBuffer().stats = stats;
+	snapshots.publish();
+}
 
-		std::unordered_map<int, std::future<bool>> tasks;
-		
-		for (size_t i = 0; i < quads.size(); ++i)
+// Copy the current state into a snapshot, except for the statistics, the columns keep their capacity between ticks
+// The previous positions are only known while no particle moved to another index since the last snapshot
+void simulationContainer::captureSnapshot(particleSnapshot& target)
+{
+	TRACE_SCOPE("snapshot");
+	size_t count = particles.getCount();
+	size_t previousCount = (particles.layoutVersion == previousLayoutVersion) ? std::min(previousX.size(), count) : 0;
+	previousX.resize(count);
+	previousY.resize(count);
+	previousLayoutVersion = particles.layoutVersion;
+
+	target.x.resize(count);
+	target.y.resize(count);
+	target.previousX.resize(count);
+	target.previousY.resize(count);
+	target.vx.resize(count);
+	target.vy.resize(count);
+	target.radius.resize(count);
+
+	parallelFor(*scheduler, partitionMode::staticChunks, count,
+		[](size_t) { return 0; },
+		[this, &target, previousCount](size_t begin, size_t end)
 		{
-			// Skip empty quadrants
-			if (quads[i]->particles.size() == 0)
-				continue; 
+			for (size_t p = begin; p < end; ++p)
+			{
+				target.previousX[p] = (p < previousCount) ? previousX[p] : particles.x[p];
+				target.previousY[p] = (p < previousCount) ? previousY[p] : particles.y[p];
+				previousX[p] = particles.x[p];
+				previousY[p] = particles.y[p];
+			}
+			std::copy(particles.x.begin() + begin, particles.x.begin() + end, target.x.begin() + begin);
+			std::copy(particles.y.begin() + begin, particles.y.begin() + end, target.y.begin() + begin);
+			std::copy(particles.vx.begin() + begin, particles.vx.begin() + end, target.vx.begin() + begin);
+			std::copy(particles.vy.begin() + begin, particles.vy.begin() + end, target.vy.begin() + begin);
+			std::copy(particles.radius.begin() + begin, particles.radius.begin() + end, target.radius.begin() + begin);
+		});
+
+	target.leafBoxes.resize(leaves.size());
+	for (size_t l = 0; l < leaves.size(); ++l)
+	{
+		target.leafBoxes[l] = leaves[l].boundary;
+	}
+	target.selectedParticles = selectedParticles;
+	target.broadphaseName = nodeBroadphase->getName();
+	target.schedulerName = getSchedulerName();
+	target.running = running;
+
+	double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	target.publishTime = now;
+	target.tickInterval = now - lastTickTime;
+	lastTickTime = now;
+}
 
-			int index = int(i);
-			tasks[index] = pool->enqueue([this, &quads, index]()
+// Gather the statistics of the current state
+void simulationContainer::updateStats()
+{
+	TRACE_SCOPE("stats");
+	simulationStats identity = {0, 0, int(leaves.size()), tickPairTests};
+	stats = parallelReduce(*scheduler, partitionMode::staticChunks, particles.getCount(), identity,
+		[](size_t) { return 0; },
+		[this, &identity](size_t begin, size_t end)
+		{
+			simulationStats chunk = identity;
+			for (size_t p = begin; p < end; ++p)
 			{
-				worker(quads[index]);
-				return true;
-			});
+				double speedSquared = particles.vx[p] * particles.vx[p] + particles.vy[p] * particles.vy[p];
+				chunk.kineticEnergy += 0.5 * speedSquared / particles.inverseMass[p];
+				chunk.maxSpeed = std::max(chunk.maxSpeed, speedSquared);
+			}
+			return chunk;
+		},
+		[](simulationStats a, simulationStats b)
+		{
+			return simulationStats{a.kineticEnergy + b.kineticEnergy, std::max(a.maxSpeed, b.maxSpeed), a.leafCount, a.pairTests};
+		});
+	stats.maxSpeed = std::sqrt(stats.maxSpeed);
+}
+
+// Update the simulation state in a single phased region of the scheduler
+// Integration, then per iteration the removal, the broadphase build and every color of leaves are phases of their own,
+// the results are the same as those of the fork-join update
+void simulationContainer::updatePhases()
+{
+	keptParticles.resize(particles.getCount());
+	phaseCounts.assign(scheduler->getThreadCount() + 1, 0);
+
+	auto tick = [this](phaseContext& phase)
+	{
+		{
+			TIME_PHASE_IF(phase.thread == 0, timedPhase::integrate);
+			TRACE_SCOPE("integrate");
+			size_t begin, end;
+			phase.split(particles.getCount(), begin, end);
+			integrateRange(begin, end);
+			phase.sync();
 		}
 
-		for (auto& [key, task]: tasks)
+		for (int i = 0; i < iterationSteps; ++i)
 		{
-			task.get();
+			removeOutOfBoundsPhase(phase);
+
+			// The broadphase is built by a single thread while the others wait
+			if (phase.thread == 0)
+			{
+				selectedParticles.clear();
+				prepareLeaves();
+				if (solver == solverMode::colored)
+					phaseCursors.assign(colorStart.begin(), colorStart.end() - 1);
+				else
+					phaseCursors.assign(1, 0);
+			}
+			phase.sync();
+
+			TIME_PHASE_IF(phase.thread == 0, timedPhase::solve);
+			solvePhases(phase);
 		}
+	};
+	scheduler->runPhases(tick);
+}
+
+// Update the positions and velocities of the particles [begin, end)
+void simulationContainer::integrateRange(size_t begin, size_t end)
+{
+	for (size_t p = begin; p < end; ++p)
+	{
+		// Calculate friction forces
+		double frictionX = (particles.vx[p] > 0) ? -friction : friction;
+		double frictionY = (particles.vy[p] > 0) ? -friction : friction;
+
+		// Update velocities with accelerations
+		particles.vx[p] += particles.ax[p];
+		particles.vy[p] += particles.ay[p];
+
+		// Update positions based on velocities
+		particles.x[p] += particles.vx[p];
+		particles.y[p] += particles.vy[p];
+
+		// Apply friction force
+		particles.vx[p] += frictionX;
+		particles.vy[p] += frictionY;
 	}
 }
 
-// Render the simulation
-void simulationContainer::render(aCamera *camera)
+// Update particles' positions and velocities
+// Every particle only touches its own columns, so chunks of particles are integrated in parallel
+void simulationContainer::integrate()
 {
-	// Render placing particle preview line if necessary
-	if(isPlacingParticle)
+	TRACE_SCOPE("integrate");
+	TIME_PHASE(timedPhase::integrate);
+	parallelFor(*scheduler, partitionMode::staticChunks, particles.getCount(),
+		[](size_t) { return 0; },
+		[this](size_t begin, size_t end) { integrateRange(begin, end); });
+}
+
+// Remove particles that left the simulation space
+// The remaining particles are compacted in one stable pass, the storage is left alone if none left
+void simulationContainer::removeOutOfBounds()
+{
+	TRACE_SCOPE("removeOutOfBounds");
+	size_t count = particles.getCount();
+	size_t remaining = parallelCompact(*scheduler, count,
+		[this](size_t p) { return isInBounds(p); },
+		keptParticles);
+
+	if (remaining < count)
+		particles.reorder(keptParticles, scheduler);
+}
+
+// Phased removeOutOfBounds, every thread counts and then lists the remaining particles of its share
+// The storage itself is compacted by thread 0, which only happens on ticks where particles left
+void simulationContainer::removeOutOfBoundsPhase(phaseContext& phase)
+{
+	TRACE_SCOPE("removeOutOfBounds");
+	size_t count = particles.getCount();
+	size_t begin, end;
+	phase.split(count, begin, end);
+
+	size_t kept = 0;
+	for (size_t p = begin; p < end; ++p)
 	{
-		float x, y;
-		SDL_GetMouseState(&x, &y);
-		vector2d mouse = {x, y};
+		if (isInBounds(p))
+			kept++;
+	}
+	phaseCounts[phase.thread] = kept;
+	phase.sync();
 
-		mouse = camera->screenToWorld(mouse);
+	size_t offset = 0;
+	size_t remaining = 0;
+	for (int t = 0; t < phase.threadCount; ++t)
+	{
+		if (t < phase.thread)
+			offset += phaseCounts[t];
+		remaining += phaseCounts[t];
+	}
+	if (remaining == count)
+		return;
 
-		camera->renderLine(placeParticlePosition, mouse, 0.1, {255, 0, 0, 255}, false);
+	for (size_t p = begin; p < end; ++p)
+	{
+		if (isInBounds(p))
+			keptParticles[offset++] = int(p);
 	}
+	phase.sync();
 
-	// Render particles 
-	for (auto& p : particles)
+	if (phase.thread == 0)
 	{
-		p -> render(camera);
+		keptParticles.resize(remaining);
+		particles.reorder(keptParticles);
 	}
+}
+
+bool simulationContainer::isInBounds(size_t p)
+{
+	return !(particles.x[p] > nodeHalfDimension ||
+		particles.x[p] < -nodeHalfDimension ||
+		particles.y[p] > nodeHalfDimension ||
+		particles.y[p] < -nodeHalfDimension);
+}
+
+// Rebuild the broadphase and resolve the collisions of all its leaves once
+void simulationContainer::solveCollisions()
+{
+	prepareLeaves();
+	solvePreparedLeaves();
+}
+
+// Resolve the collisions of the leaves collected by prepareLeaves
+void simulationContainer::solvePreparedLeaves()
+{
+	TRACE_SCOPE("solve");
+	TIME_PHASE(timedPhase::solve);
+	if (solver == solverMode::colored)
+	{
+		for (int color = 0; color < maxColors; ++color)
+		{
+			solveLeaves(coloredLeaves, colorStart[color], colorStart[color + 1]);
+		}
 
-	//Render debug information for particles in the selected quadtree
-	if(selectedQuadTree != nullptr)
+		// Leaves without a free color may share particles with each other, so they run on this thread
+		TIME_THREAD_SOLVE();
+		for (int l = colorStart[maxColors]; l < colorStart[maxColors + 1]; ++l)
+		{
+			worker(coloredLeaves[l]);
+		}
+	}
+	else
 	{
-		 for(auto& p : selectedQuadTree->particles)
-		 {
-			 p -> renderDebug(camera);
-		 }
+		solveLeaves(leaves, 0, leaves.size());
 	}
+}
 
-	// Render static lines and their normals
-	for(auto& l : staticLines)
+// Rebuild the broadphase and collect its leaves, grouped by color for the colored solver
+void simulationContainer::prepareLeaves()
+{
+	TRACE_SCOPE("broadphase");
+	TIME_PHASE(timedPhase::rebuild);
+	nodeBroadphase->build(particles);
+
+	leaves.clear();
+	nodeBroadphase->getLeaves(leaves);
+
+	// The half-pair kernel tests every home particle against the particles listed after it
+	for (const broadphaseLeaf& leaf : leaves)
 	{
-		l.render(camera);
-		l.renderNormal(camera);
+		long long count = leaf.count;
+		long long homes = leaf.homeCount;
+		tickPairTests += halfPairs ? homes * count - homes * (homes + 1) / 2 : count * (count - 1);
 	}
+
+	if (solver == solverMode::colored)
+		colorLeaves();
 }
 
-// Select a quadtree
-void simulationContainer::select(aCamera* camera)
+// Phased solveCollisions, the threads claim leaves one by one and meet after every color
+void simulationContainer::solvePhases(phaseContext& phase)
 {
-	// Retrieve all leaf nodes of the quadtree
-	std::vector<quadTree*> quads;
-	nodeQuadTree->getLeaves(quads);
+	TRACE_SCOPE("solve");
+	auto claim = [this](std::vector<broadphaseLeaf>& batchLeaves, int cursor, int last)
+	{
+		TIME_THREAD_SOLVE();
+		std::atomic_ref<int> next(phaseCursors[cursor]);
+		for (int l = next.fetch_add(1, std::memory_order_relaxed); l < last; l = next.fetch_add(1, std::memory_order_relaxed))
+		{
+			worker(batchLeaves[l]);
+		}
+	};
 
-	// Get the current mouse position
-	float x, y;
-	SDL_GetMouseState(&x, &y);
-	vector2d mouse = {x, y};
-	mouse = camera->screenToWorld(mouse);
+	if (solver == solverMode::colored)
+	{
+		for (int color = 0; color < maxColors; ++color)
+		{
+			if (colorStart[color] == colorStart[color + 1])
+				continue;
+
+			claim(coloredLeaves, color, colorStart[color + 1]);
+			phase.sync();
+		}
 
-	// Iterate through each leaf node of the quadtree
-	for(auto& q : quads)
+		// Leaves without a free color may share particles with each other, so they run on one thread
+		if (phase.thread == 0)
+		{
+			TIME_THREAD_SOLVE();
+			for (int l = colorStart[maxColors]; l < colorStart[maxColors + 1]; ++l)
+			{
+				worker(coloredLeaves[l]);
+			}
+		}
+	}
+	else
 	{
-		// Check if the mouse position falls within the bounds of the current quadtree node
-		if(mouse.x < q->boundary.center.x + q->boundary.halfDimension &&
-			mouse.x > q->boundary.center.x - q->boundary.halfDimension &&
-			mouse.y < q->boundary.center.y + q->boundary.halfDimension &&
-			mouse.y > q->boundary.center.y - q->boundary.halfDimension)
+		claim(leaves, 0, int(leaves.size()));
+	}
+	phase.sync();
+}
+
+// Solve a range of leaves on the scheduler and wait for them
+// The work of a leaf grows with the square of its particles, which sets the chunking of the leaves
+void simulationContainer::solveLeaves(std::vector<broadphaseLeaf>& batchLeaves, size_t first, size_t last)
+{
+	parallelFor(*scheduler, partition, last - first,
+		[&batchLeaves, first](size_t l)
 		{
-			selectedQuadTree = q;
-			break;
+			double count = batchLeaves[first + l].count;
+			return count * count;
+		},
+		[this, &batchLeaves, first](size_t begin, size_t end)
+		{
+			TIME_THREAD_SOLVE();
+			for (size_t l = begin; l < end; ++l)
+			{
+				worker(batchLeaves[first + l]);
+			}
+		});
+}
+
+// Greedily color the leaves so that leaves sharing a particle never get the same color
+// Leaves of one color touch disjoint particles and can be solved concurrently without races,
+// the colored leaves are grouped by color with colorStart holding the range of every color
+void simulationContainer::colorLeaves()
+{
+	particleColors.assign(particles.getCount(), 0);
+	leafColors.resize(leaves.size());
+	colorStart.assign(maxColors + 2, 0);
+
+	for (size_t l = 0; l < leaves.size(); ++l)
+	{
+		// Collect the colors of earlier leaves holding any of this leaf's particles
+		uint64_t used = 0;
+		for (int k = 0; k < leaves[l].count; ++k)
+		{
+			used |= particleColors[leaves[l].particles[k]];
 		}
+
+		int color = std::countr_one(used);
+		leafColors[l] = color;
+		colorStart[color + 1]++;
+
+		if (color == maxColors)
+			continue;
+
+		for (int k = 0; k < leaves[l].count; ++k)
+		{
+			particleColors[leaves[l].particles[k]] |= uint64_t(1) << color;
+		}
+	}
+
+	for (int color = 0; color <= maxColors; ++color)
+	{
+		colorStart[color + 1] += colorStart[color];
+	}
+
+	colorCursor.assign(colorStart.begin(), colorStart.end() - 1);
+	coloredLeaves.resize(leaves.size());
+	for (size_t l = 0; l < leaves.size(); ++l)
+	{
+		coloredLeaves[colorCursor[leafColors[l]]++] = leaves[l];
 	}
 }
 
+// Switch to the latest published snapshot, returns false if there is none newer than the current one
+// Called by the render thread only
+bool simulationContainer::acquireSnapshot()
+{
+	return snapshots.acquire();
+}
 
-// Render the quadtree structure on the screen
-void simulationContainer::renderQuadTree(aCamera *camera, vector2d mouse)
+// Snapshot the render thread switched to last
+const particleSnapshot& simulationContainer::getSnapshot()
 {
-	// Return if the quadtree is not initialized
-	if (nodeQuadTree == nullptr)
-		return;
+	return snapshots.getReadBuffer();
+}
 
-	nodeQuadTree -> render(camera, mouse);
+// Select the hovered leaf of the broadphase
+// The position is given in world coordinates
+void simulationContainer::select(vector2d mouse)
+{
+	// Retrieve all leaves of the broadphase
+	std::vector<broadphaseLeaf> selectLeaves;
+	nodeBroadphase->getLeaves(selectLeaves);
+
+	// Iterate through each leaf
+	for(auto& l : selectLeaves)
+	{
+		// Check if the mouse position falls within the bounds of the current leaf
+		if(mouse.x < l.boundary.center.x + l.boundary.halfDimension &&
+			mouse.x > l.boundary.center.x - l.boundary.halfDimension &&
+			mouse.y < l.boundary.center.y + l.boundary.halfDimension &&
+			mouse.y > l.boundary.center.y - l.boundary.halfDimension)
+		{
+			selectedParticles.assign(l.particles, l.particles + l.count);
+			break;
+		}
+	}
 }
 
+
 // Start placing and place a particle at a specified position
 void simulationContainer::placeParticle(vector2d position, double radius, bool state)
 {
@@ -210,11 +613,10 @@ void simulationContainer::placeParticle(vector2d position, double radius, bool s
 	else
 	{
 		// Add a new particle to the simulation at the position where the mouse was released
-		particles.push_back(new particle(placeParticlePosition, radius));
+		particle p(&particles, particles.add(placeParticlePosition, radius, density));
 		
 		// Set the velocity of the newly added particle towards the release position of the mouse
-		particles[particles.size() - 1] -> setVelocity(placeParticlePosition.getVector(position));
-		particles[particles.size() - 1] -> setVelocity(particles[particles.size() - 1] -> getVelocity() / -10);
+		p.setVelocity(placeParticlePosition.getVector(position) / -10);
 		
 		// Deactivate placement mode
 		isPlacingParticle = false;
@@ -233,6 +635,12 @@ void simulationContainer::addStaticLine(int a, int b)
 	staticLines.push_back(staticLine(&staticPoints[a], &staticPoints[b]));
 }
 
+// Static lines of the simulation, they are only added before the simulation starts
+const std::vector<staticLine>& simulationContainer::getStaticLines()
+{
+	return staticLines;
+}
+
 // Toggle the simulation running state
 void simulationContainer::switchRunning()
 {
@@ -245,88 +653,319 @@ bool simulationContainer::getRunning()
 	return running;
 }
 
+// Replace the scheduler with one placing its threads by the given settings
+void simulationContainer::setSchedulerSettings(const schedulerSettings& settings)
+{
+	delete scheduler;
+	scheduler = new taskScheduler(settings);
+}
+
+taskScheduler* simulationContainer::getScheduler()
+{
+	return scheduler;
+}
+
+// Describe the worker threads and their placement, for the debug menu
+std::string simulationContainer::getSchedulerName()
+{
+	const schedulerSettings& settings = scheduler->getSettings();
+	std::string name = std::to_string(settings.threadCount) + " workers";
+	if (settings.pinning)
+		name += ", pinned";
+	if (settings.reserveMainCore)
+		name += ", main core";
+	return name;
+}
+
+// Enable or disable keeping the particle storage in Z-order
+void simulationContainer::setReordering(bool enabled)
+{
+	reordering = enabled;
+	ticksSinceReorder = 0;
+}
+
+// Select whether a tick runs as fork-join loops, one phased region or a task graph
+void simulationContainer::setExecutionMode(executionMode mode)
+{
+	execution = mode;
+}
+
+// Set the number of collision passes per tick
+void simulationContainer::setIterationSteps(int steps)
+{
+	iterationSteps = std::max(steps, 1);
+}
+
+// Select how leaves are distributed over the scheduler
+void simulationContainer::setSolverMode(solverMode mode)
+{
+	solver = mode;
+}
+
+// Select how leaves are chunked for the scheduler
+void simulationContainer::setPartitionMode(partitionMode mode)
+{
+	partition = mode;
+}
+
+// Select between solving every pair once and the previous kernel solving every ordered pair
+void simulationContainer::setHalfPairs(bool enabled)
+{
+	halfPairs = enabled;
+}
+
+// Select the instruction set of the narrow phase, levels the CPU doesn't support are rejected
+void simulationContainer::setSimdLevel(simdLevel level)
+{
+	if (level > supportedSimdLevel)
+	{
+		log::error("simulationContainer::setSimdLevel - '{}' is not supported by this CPU", ::getSimdLevelName(level));
+		return;
+	}
+	narrowphaseLevel = level;
+}
+
+// Get the name of the instruction set used by the narrow phase
+std::string simulationContainer::getSimdLevelName()
+{
+	return ::getSimdLevelName(narrowphaseLevel);
+}
+
+// Compute the Z-order keys of all particles and return the fraction of neighbours in storage that are out of order
+double simulationContainer::getDisorder()
+{
+	int count = particles.getCount();
+	if (count < 2)
+		return 0;
+
+	mortonKeys.resize(count);
+	parallelFor(*scheduler, partitionMode::staticChunks, count,
+		[](size_t) { return 1; },
+		[this](size_t begin, size_t end)
+		{
+			for (size_t p = begin; p < end; ++p)
+			{
+				mortonKeys[p] = mortonKey(particles.x[p], particles.y[p], nodeHalfDimension);
+			}
+		});
+
+	int descents = parallelReduce(*scheduler, partitionMode::staticChunks, count - 1, 0,
+		[](size_t) { return 1; },
+		[this](size_t begin, size_t end)
+		{
+			int chunkDescents = 0;
+			for (size_t p = begin; p < end; ++p)
+			{
+				if (mortonKeys[p + 1] < mortonKeys[p])
+					chunkDescents++;
+			}
+			return chunkDescents;
+		},
+		[](int a, int b) { return a + b; });
+
+	return double(descents) / (count - 1);
+}
+
+// Sort the particle storage along the Z-order curve so that spatial neighbours share cache lines
+// Expects the keys computed by getDisorder
+void simulationContainer::reorderParticles()
+{
+	TRACE_SCOPE("reorder");
+	int count = particles.getCount();
+	mortonOrder.resize(count);
+	for (int p = 0; p < count; ++p)
+	{
+		mortonOrder[p] = p;
+	}
+
+	parallelRadixSort(mortonKeys, mortonOrder, mortonKeyScratch, mortonOrderScratch, scheduler, scheduler->getThreadCount() + 1);
+	particles.reorder(mortonOrder, scheduler);
+
+	// Indices of the selected leaf no longer refer to the same particles
+	selectedParticles.clear();
+}
+
+// Replace the broadphase with a new one of the given type
+void simulationContainer::setBroadphase(broadphaseType type)
+{
+	delete nodeBroadphase;
+	nodeBroadphaseType = type;
+	nodeBroadphase = createBroadphase(nodeBroadphaseType, nodeHalfDimension, quadrantCapacity, cellSize);
+	selectedParticles.clear();
+	leaves.clear();
+
+	log::info("simulationContainer::setBroadphase - Using broadphase '{}'", nodeBroadphase->getName());
+}
+
+// Switch to the next available broadphase
+void simulationContainer::switchBroadphase()
+{
+	setBroadphase(nextBroadphaseType(nodeBroadphaseType));
+}
+
+// Get the name of the broadphase in use
+std::string simulationContainer::getBroadphaseName()
+{
+	return nodeBroadphase->getName();
+}
+
 // Add a particle to the simulation
 void simulationContainer::addParticle(vector2d position, double radius)
 {
-	particles.push_back(new particle(position, radius));
+	particles.add(position, radius, density);
+}
+
+// Get a view of a particle by its ID
+particle simulationContainer::getParticle(int id)
+{
+	return particle(&particles, id);
 }
 
-// Get a pointer to a particle by its ID
-particle* simulationContainer::getParticle(int id)
+// Get the statistics of the state at the end of the last tick
+simulationStats simulationContainer::getStats()
 {
-	return particles[id];
+	return stats;
 }
 
 // Get the count of particles in the simulation
 int simulationContainer::getParticleCount()
 {
-	return int(particles.size());
+	return particles.getCount();
 }
 
-void simulationContainer::worker(quadTree* q)
+// Resolve the collisions inside a single leaf on the calling thread
+// The leaf must only hold particles of this simulation, used to benchmark the pair kernels in isolation
+void simulationContainer::solveLeaf(const broadphaseLeaf& leaf)
 {
-	for (particle* a : q->particles)
-	{
-		vector2d positionA = a->getPosition();
-		vector2d velocityA = a->getVelocity();
-		double radiusA = a->getRadius();
-		double areaA = a->getArea();
+	worker(leaf);
+}
 
-		for (particle* b : q->particles)
-		{
-			if (a == b) // Skip collision checks with the same particle
-				continue;
+// Solve a leaf with the selected pair kernel
+void simulationContainer::worker(const broadphaseLeaf& leaf)
+{
+	TRACE_SCOPE_ARG("leaf", "particles", leaf.count);
+	if (halfPairs)
+		halfPairWorker(leaf);
+	else
+		orderedPairWorker(leaf);
+}
 
-			vector2d positionB = b->getPosition();
+// Resolve the collision of particle a, held in local copies, with particle b, which is written directly
+inline void simulationContainer::collide(vector2d& positionA, vector2d& velocityA, double radiusA, double inverseMassA, int b)
+{
+	vector2d positionB = {particles.x[b], particles.y[b]};
 
-			double radiiSum = radiusA + b->getRadius();
+	double radiiSum = radiusA + particles.radius[b];
 
-			if (std::abs(positionA.x - positionB.x) >= radiiSum ||
-				std::abs(positionA.y - positionB.y) >= radiiSum) // Skip collision detection if particles are not close enough
-				continue;
+	if (std::abs(positionA.x - positionB.x) >= radiiSum ||
+		std::abs(positionA.y - positionB.y) >= radiiSum) // Skip collision detection if particles are not close enough
+		return;
 
-			double distanceSquared = positionA.distanceSquared(positionB);
-			double radiiSumSquared = radiiSum * radiiSum;
-			if (distanceSquared > radiiSumSquared) // Skip collision detection if particles are not close enough
-				continue;
+	double distanceSquared = positionA.distanceSquared(positionB);
+	double radiiSumSquared = radiiSum * radiiSum;
+	if (distanceSquared > radiiSumSquared) // Skip collision detection if particles are not close enough
+		return;
 
-			double overlapDistance = radiiSum - std::sqrt(distanceSquared);
-			if (overlapDistance <= 0)
-				continue;
+	double overlapDistance = radiiSum - std::sqrt(distanceSquared);
+	if (overlapDistance <= 0)
+		return;
+
+	vector2d overlap = positionA.getVector(positionB);
+	overlap.normalize(overlapDistance);
+
+	double inverseMassB = particles.inverseMass[b];
+
+	// Each particle is pushed out by a share inversely proportional to its mass
+	double inverseMassSum = inverseMassA + inverseMassB;
+	double shareA = inverseMassA / inverseMassSum;
+	double shareB = inverseMassB / inverseMassSum;
+
+	positionA.x += overlap.x * shareA;
+	positionA.y += overlap.y * shareA;
+	
+	positionB.x -= overlap.x * shareB;
+	positionB.y -= overlap.y * shareB;
 
-			vector2d overlap = positionA.getVector(positionB);
-			overlap.normalize(overlapDistance);
+	vector2d collisionNormal = positionA.getVector(positionB);
+	collisionNormal.normalize(1);
 
-			double areaB = b->getArea();
+	vector2d velocity = vector2d(particles.vx[b], particles.vy[b]) - velocityA;
+	double relativeVelocity = velocity.dot(collisionNormal);
 
-			double totalArea = areaA + areaB;
-			double factorA = areaA / totalArea;
-			double factorB = areaB / totalArea;
+	double impulse = -((1 + restitution) * relativeVelocity) / inverseMassSum;
 
-			positionA.x += overlap.x * factorB;
-			positionA.y += overlap.y * factorB;
-			
-			positionB.x -= overlap.x * factorA;
-			positionB.y -= overlap.y * factorA;
+	velocityA.x -= impulse * inverseMassA * collisionNormal.x * (1 - energyLoss);
+	velocityA.y -= impulse * inverseMassA * collisionNormal.y * (1 - energyLoss);
+	
+	particles.vx[b] += impulse * inverseMassB * collisionNormal.x * (1 - energyLoss);
+	particles.vy[b] += impulse * inverseMassB * collisionNormal.y * (1 - energyLoss);
 
-			vector2d collisionNormal = positionA.getVector(positionB);
-			collisionNormal.normalize(1);
+	particles.x[b] = positionB.x;
+	particles.y[b] = positionB.y;
+}
 
-			vector2d velocity = b->getVelocity() - velocityA;
-			double relativeVelocity = velocity.dot(collisionNormal);
+// Resolve every pair of the leaf once
+// A pair of a home particle and a ghost also meets in the ghost's home leaf,
+// it is solved in the home leaf of the smaller particle, the lower index breaking ties
+void simulationContainer::halfPairWorker(const broadphaseLeaf& leaf)
+{
+	// Pairs of two ghosts are owned by other leaves
+	for (int i = 0; i < leaf.homeCount; ++i)
+	{
+		int a = leaf.particles[i];
+		vector2d positionA = {particles.x[a], particles.y[a]};
+		vector2d velocityA = {particles.vx[a], particles.vy[a]};
+		double radiusA = particles.radius[a];
+		double inverseMassA = particles.inverseMass[a];
 
-			double impulse = -((1 + restitution) * relativeVelocity) / (1 / (areaA * density) + 1 / (areaB * density));
+		for (int j = i + 1; ; ++j)
+		{
+			// Skip the candidates whose bounds don't touch the current bounds of a
+			j = nextContact(narrowphaseLevel, particles, positionA, radiusA, leaf.particles, j, leaf.count);
+			if (j == leaf.count)
+				break;
 
-			velocityA.x -= (impulse / (areaA * density)) * collisionNormal.x * (1 - energyLoss);
-			velocityA.y -= (impulse / (areaA * density)) * collisionNormal.y * (1 - energyLoss);
-			
-			b->setVelocity({b->getVelocity().x + (impulse / (areaB * density)) * collisionNormal.x * (1 - energyLoss),
-						   b->getVelocity().y + (impulse / (areaB * density)) * collisionNormal.y * (1 - energyLoss)});
+			int b = leaf.particles[j];
+			if (j >= leaf.homeCount)
+			{
+				double radiusB = particles.radius[b];
+				if (radiusB < radiusA || (radiusB == radiusA && b < a))
+					continue;
+			}
 
-			b->setPosition(positionB);
+			collide(positionA, velocityA, radiusA, inverseMassA, b);
 		}
 
-		a->setPosition(positionA);
-		a->setVelocity(velocityA);
+		particles.x[a] = positionA.x;
+		particles.y[a] = positionA.y;
+		particles.vx[a] = velocityA.x;
+		particles.vy[a] = velocityA.y;
 	}
 }
+
+// Resolve every ordered pair of the leaf, so every pair is solved twice per leaf it shares
+void simulationContainer::orderedPairWorker(const broadphaseLeaf& leaf)
+{
+	for (int i = 0; i < leaf.count; ++i)
+	{
+		int a = leaf.particles[i];
+		vector2d positionA = {particles.x[a], particles.y[a]};
+		vector2d velocityA = {particles.vx[a], particles.vy[a]};
+		double radiusA = particles.radius[a];
+		double inverseMassA = particles.inverseMass[a];
+
+		for (int j = 0; j < leaf.count; ++j)
+		{
+			int b = leaf.particles[j];
+			if (a == b) // Skip collision checks with the same particle
+				continue;
+
+			collide(positionA, velocityA, radiusA, inverseMassA, b);
+		}
+
+		particles.x[a] = positionA.x;
+		particles.y[a] = positionA.y;
+		particles.vx[a] = velocityA.x;
+		particles.vy[a] = velocityA.y;
+	}
+}
\ No newline at end of file
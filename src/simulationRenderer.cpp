@@ -0,0 +1,150 @@
+#include "simulationRenderer.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "parallel.hpp"
+#include "trace.hpp"
+
+SDL_Color getSpeedColor(double speed)
+{
+	SDL_Color color = {255, 255, 255, 255};
+	Uint8 factor = Uint8(mapRange(clamp(speed, 0, 30), 0, 30, 0, 255));
+	color.g -= factor;
+	color.b -= factor;
+	return color;
+}
+
+void renderBox(aCamera* camera, quadTreeBox box, vector2d mouse)
+{
+	vector2d center = box.center;
+	double halfDimension = box.halfDimension;
+
+	// Draw the boundary of the quadrant
+	vector2d pos = {center.x - halfDimension, center.y - halfDimension};
+	vector2d size = {halfDimension * 2, halfDimension * 2};
+	SDL_Color color = {0, 128, 255, 16};
+
+	mouse = camera -> screenToWorld(mouse);
+	if(mouse.x < pos.x+size.x && mouse.x > pos.x && mouse.y < pos.y+size.y && mouse.y > pos.y)
+		color = {255, 0, 0, 16};
+
+	SDL_FRect rect = {float(pos.x), float(pos.y), float(size.x), float(size.y)};
+	camera -> renderRect(rect, color, false);
+
+	// Draw the lines of the quadrant
+	color.a += 32;
+	vector2d a = {center.x - halfDimension + 0.2, center.y - halfDimension + 0.2};
+	vector2d b = {center.x - halfDimension + 0.2, center.y + halfDimension - 0.2};
+	camera -> renderLine(a, b, 2, color, false);
+
+	a = {center.x + halfDimension - 0.2, center.y + halfDimension - 0.2};
+	b = {center.x + halfDimension - 0.2, center.y - halfDimension + 0.2};
+	camera -> renderLine(a, b, 2, color, false);
+
+	a = {center.x - halfDimension + 0.2, center.y - halfDimension + 0.2};
+	b = {center.x + halfDimension - 0.2, center.y - halfDimension + 0.2};
+	camera -> renderLine(a, b, 2, color, false);
+
+
+	a = {center.x + halfDimension - 0.2, center.y + halfDimension - 0.2};
+	b = {center.x - halfDimension + 0.2, center.y + halfDimension - 0.2};
+	camera -> renderLine(a, b, 2, color, false);
+}
+
+// simulationRenderer class constructor
+simulationRenderer::simulationRenderer(simulationContainer* nContainer, const schedulerSettings& nSettings)
+: container(nContainer)
+{
+	schedulerSettings settings = nSettings;
+	int available = int(taskScheduler::getAvailableCores().size()) - 1;
+	settings.threadCount = std::min((settings.threadCount > 0) ? settings.threadCount : available, maxWorkers);
+	scheduler = new taskScheduler(settings);
+}
+
+simulationRenderer::~simulationRenderer()
+{
+	delete scheduler;
+}
+
+void simulationRenderer::prepareDiscs(double alpha)
+{
+	TRACE_SCOPE("discs");
+	const particleSnapshot& snapshot = container->getSnapshot();
+	size_t count = snapshot.x.size();
+	discs.reserve(int(count));
+
+	// Every chunk packs its visible particles at the start of its own slots
+	int threads = scheduler->getThreadCount() + 1;
+	parallelChunks chunks;
+	auto cost = [](size_t) { return 0; };
+	planChunks(chunks, partitionMode::staticChunks, threads, count, cost);
+
+	std::array<int, maxParallelChunks> visible;
+	auto chunk = [&](int k)
+	{
+		int slot = int(chunks.bounds[k]);
+		for (size_t p = chunks.bounds[k]; p < chunks.bounds[k + 1]; ++p)
+		{
+			double x = snapshot.previousX[p] + (snapshot.x[p] - snapshot.previousX[p]) * alpha;
+			double y = snapshot.previousY[p] + (snapshot.y[p] - snapshot.previousY[p]) * alpha;
+			double speed = std::sqrt(snapshot.vx[p] * snapshot.vx[p] + snapshot.vy[p] * snapshot.vy[p]);
+			if (discs.setDisc(slot, x, y, snapshot.radius[p], getSpeedColor(speed)))
+				slot++;
+		}
+		visible[k] = slot - int(chunks.bounds[k]);
+	};
+	runChunks(*scheduler, partitionMode::staticChunks, threads, chunks.count, chunk);
+
+	for (int k = 0; k < chunks.count; ++k)
+	{
+		discs.addRange(int(chunks.bounds[k]), visible[k]);
+	}
+}
+
+// Render the current snapshot, interpolated by alpha between its previous and current positions
+// Only reads the snapshot, so the simulation thread may tick meanwhile
+void simulationRenderer::render(aCamera *camera, double alpha)
+{
+	const particleSnapshot& snapshot = container->getSnapshot();
+
+	// Render particles in one batch
+	camera->beginDiscs(discs);
+	prepareDiscs(alpha);
+	camera->renderDiscs(discs);
+
+	//Render debug information for particles in the selected leaf
+	for(int p : snapshot.selectedParticles)
+	{
+		if (p >= int(snapshot.x.size()))
+			continue;
+
+		vector2d position = {snapshot.x[p], snapshot.y[p]};
+		vector2d velocity = {snapshot.vx[p], snapshot.vy[p]};
+		camera->renderDisc(position, snapshot.radius[p], {255, 255, 0, 128}, false);
+		camera->renderLine(position, position + velocity * 10, 0.1, {255, 0, 0, 255}, false);
+	}
+
+	// Render static lines and their normals
+	for(staticLine l : container->getStaticLines())
+	{
+		vector2d middle = (l.a->position + l.b->position) / 2;
+		camera->renderLine(l.a->position, l.b->position, 0.01, {255, 255, 255, 255}, false);
+		camera->renderLine(middle, middle + (l.getNormal() / 16), 0.1, {0, 0, 255, 255}, false);
+	}
+}
+
+// Render the leaves of the broadphase in the current snapshot on the screen
+void simulationRenderer::renderBroadphase(aCamera *camera, vector2d mouse)
+{
+	for (quadTreeBox box : container->getSnapshot().leafBoxes)
+	{
+		renderBox(camera, box, mouse);
+	}
+}
+
+// Discs of the last prepared frame
+discBatch& simulationRenderer::getDiscs()
+{
+	return discs;
+}
@@ -0,0 +1,122 @@
+#include "simulationThread.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+#include "allocationStats.hpp"
+#include "log.hpp"
+#include "trace.hpp"
+
+simulationThread::simulationThread(simulationContainer* nContainer, double nTimeStep)
+: container(nContainer), timeStep(nTimeStep), stopping(false), tickCount(0), tickAllocations(0)
+{}
+
+void simulationThread::start(const std::vector<int>& cores)
+{
+	// Publish the initial state, the render thread has nothing to draw before
+	container->publishSnapshot();
+
+	stopping = false;
+	thread = std::thread([this]() { loop(); });
+	if (!cores.empty() && !taskScheduler::setThreadAffinity(thread, cores))
+		log::error("simulationThread::start - Failed to set the affinity of the simulation thread");
+	log::info("simulationThread::start - Ticking every {} s on a thread of its own", timeStep);
+}
+
+void simulationThread::stop()
+{
+	if (!thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(commandMutex);
+		stopping = true;
+	}
+	commandCondition.notify_one();
+	thread.join();
+}
+
+void simulationThread::post(std::function<void(simulationContainer&)> command)
+{
+	{
+		std::lock_guard<std::mutex> lock(commandMutex);
+		commands.push_back(std::move(command));
+	}
+	commandCondition.notify_one();
+}
+
+int simulationThread::takeTickCount()
+{
+	return tickCount.exchange(0);
+}
+
+long long simulationThread::takeTickAllocations()
+{
+	return tickAllocations.exchange(0);
+}
+
+// Run the posted commands, returns false if there were none
+bool simulationThread::runCommands()
+{
+	{
+		std::lock_guard<std::mutex> lock(commandMutex);
+		runningCommands.swap(commands);
+	}
+	if (runningCommands.empty())
+		return false;
+
+	TRACE_SCOPE_ARG("commands", "count", runningCommands.size());
+
+	for (auto& command : runningCommands)
+	{
+		command(*container);
+	}
+	runningCommands.clear();
+	return true;
+}
+
+// Fixed time step loop, sleeping until the next tick is due or a command arrives
+// A paused simulation still publishes a snapshot after commands, so that their effect shows up
+void simulationThread::loop()
+{
+	using clock = std::chrono::steady_clock;
+
+	tracer::setThreadName("simulation");
+
+	clock::time_point currentTime = clock::now();
+	double accumulator = 0;
+	while (!stopping.load())
+	{
+		bool changed = runCommands();
+
+		clock::time_point newTime = clock::now();
+		accumulator += std::chrono::duration<double>(newTime - currentTime).count();
+		currentTime = newTime;
+
+		// Drop the time the simulation was paused, or fell behind by more than it can catch up on
+		if (!container->getRunning())
+			accumulator = 0;
+		accumulator = std::min(accumulator, maxCatchUpTicks * timeStep);
+
+		bool ticked = false;
+		while (accumulator >= timeStep)
+		{
+			TRACE_SCOPE("tick");
+			long long allocations = allocationStats::heapAllocations.load(std::memory_order_relaxed);
+			container->update();
+			tickAllocations += allocationStats::heapAllocations.load(std::memory_order_relaxed) - allocations;
+			tickCount++;
+
+			accumulator -= timeStep;
+			ticked = true;
+		}
+
+		if (changed && !ticked)
+			container->publishSnapshot();
+
+		// Sleep until the next tick is due, a posted command wakes the thread right away
+		double wait = container->getRunning() ? timeStep - accumulator : timeStep;
+		std::unique_lock<std::mutex> lock(commandMutex);
+		commandCondition.wait_for(lock, std::chrono::duration<double>(wait), [this]() { return stopping.load() || !commands.empty(); });
+	}
+}
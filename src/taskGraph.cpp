@@ -0,0 +1,72 @@
+#include "taskGraph.hpp"
+
+#include <atomic>
+
+#include "log.hpp"
+
+taskGraph::taskGraph()
+{}
+
+int taskGraph::addNode(const std::string& name, std::function<void()> work)
+{
+	nodes.push_back({name, std::move(work), {}, 0});
+	return int(nodes.size()) - 1;
+}
+
+void taskGraph::addDependency(int before, int after)
+{
+	if (before < 0 || after < 0 || before >= int(nodes.size()) || after >= int(nodes.size()) || before == after)
+	{
+		log::error("taskGraph::addDependency - Invalid dependency from node {} to node {}", before, after);
+		return;
+	}
+
+	nodes[before].successors.push_back(after);
+	nodes[after].dependencies++;
+}
+
+void taskGraph::clear()
+{
+	nodes.clear();
+}
+
+void taskGraph::run(taskScheduler& scheduler)
+{
+	pending.resize(nodes.size());
+	for (size_t n = 0; n < nodes.size(); ++n)
+	{
+		pending[n] = nodes[n].dependencies;
+	}
+
+	taskGroup group;
+	nodeTask start = {this, &scheduler, &group};
+	for (size_t n = 0; n < nodes.size(); ++n)
+	{
+		if (nodes[n].dependencies == 0)
+			scheduler.submit(group, start, n, n + 1);
+	}
+	scheduler.wait(group);
+}
+
+void taskGraph::nodeTask::operator()(size_t begin, size_t)
+{
+	node& current = graph->nodes[begin];
+	current.work();
+
+	for (int successor : current.successors)
+	{
+		std::atomic_ref<int> remaining(graph->pending[successor]);
+		if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			scheduler->submit(*group, *this, successor, successor + 1);
+	}
+}
+
+int taskGraph::getNodeCount()
+{
+	return int(nodes.size());
+}
+
+const std::string& taskGraph::getNodeName(int node)
+{
+	return nodes[node].name;
+}
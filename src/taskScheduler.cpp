@@ -0,0 +1,539 @@
+#include "taskScheduler.hpp"
+
+#include <algorithm>
+
+#include "log.hpp"
+#include "trace.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() std::this_thread::yield()
+#endif
+
+// Rounds an idle thread keeps looking for work before yielding, and before going to sleep
+static const int spinRounds = 64;
+static const int yieldRounds = 256;
+
+static std::atomic<int> nextSchedulerId(0);
+
+// Scheduler and deque of the current thread if it is a worker, -1 otherwise
+static thread_local int currentScheduler = -1;
+static thread_local int currentSlot = -1;
+
+// External deque the current thread holds in a scheduler
+struct externalClaim
+{
+	int scheduler;
+	int index; // Index in the scheduler's externalSlotTable
+	std::shared_ptr<externalSlotTable> table;
+};
+
+// External deques of the current thread, given back when the thread exits
+struct externalClaims
+{
+	~externalClaims()
+	{
+		for (externalClaim& claim : claims)
+		{
+			claim.table->taken[claim.index].store(false, std::memory_order_release);
+		}
+	}
+
+	std::vector<externalClaim> claims;
+};
+
+static thread_local externalClaims currentClaims;
+static thread_local uint32_t stealSeed = 0x9e3779b9u;
+
+// Restrict a thread to the given cores, returns false if the platform refused or doesn't support it
+static bool setAffinity(std::thread::native_handle_type thread, const std::vector<int>& cores)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int core : cores)
+	{
+		CPU_SET(core, &set);
+	}
+	return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+	DWORD_PTR mask = 0;
+	for (int core : cores)
+	{
+		if (core < int(sizeof(DWORD_PTR) * 8))
+			mask |= DWORD_PTR(1) << core;
+	}
+	return SetThreadAffinityMask(thread, mask) != 0;
+#else
+	(void)thread;
+	(void)cores;
+	return false;
+#endif
+}
+
+static bool setCurrentAffinity(const std::vector<int>& cores)
+{
+#if defined(__linux__)
+	return setAffinity(pthread_self(), cores);
+#elif defined(_WIN32)
+	return setAffinity(GetCurrentThread(), cores);
+#else
+	(void)cores;
+	return false;
+#endif
+}
+
+void taskSlot::store(const task& t)
+{
+	run.store(t.run, std::memory_order_relaxed);
+	context.store(t.context, std::memory_order_relaxed);
+	begin.store(t.begin, std::memory_order_relaxed);
+	end.store(t.end, std::memory_order_relaxed);
+	group.store(t.group, std::memory_order_relaxed);
+}
+
+void taskSlot::load(task& t)
+{
+	t.run = run.load(std::memory_order_relaxed);
+	t.context = context.load(std::memory_order_relaxed);
+	t.begin = begin.load(std::memory_order_relaxed);
+	t.end = end.load(std::memory_order_relaxed);
+	t.group = group.load(std::memory_order_relaxed);
+}
+
+void phaseBarrier::arrive(bool& localSense)
+{
+	localSense = !localSense;
+
+	// The last thread to arrive resets the count for the next phase and releases the others
+	if (waiting.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		waiting.store(participants, std::memory_order_relaxed);
+		sense.store(localSense);
+		if (sleepers.load() > 0)
+			sense.notify_all();
+		return;
+	}
+
+	int idleRounds = 0;
+	while (sense.load(std::memory_order_acquire) != localSense)
+	{
+		idleRounds++;
+		if (idleRounds < spinRounds)
+		{
+			CPU_RELAX();
+		}
+		else if (idleRounds < spinRounds + yieldRounds)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			// Returns right away if the sense flipped after the loop checked it
+			sleepers++;
+			sense.wait(!localSense);
+			sleepers--;
+		}
+	}
+}
+
+// Add a task at the bottom, fails if the deque is full
+bool taskDeque::push(const task& t)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t tp = top.load(std::memory_order_acquire);
+	if (b - tp >= capacity)
+		return false;
+
+	slots[b & (capacity - 1)].store(t);
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+// Take the most recently pushed task, only called by the owner
+bool taskDeque::pop(task& t)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t tp = top.load(std::memory_order_relaxed);
+
+	if (tp > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	slots[b & (capacity - 1)].load(t);
+	if (tp == b)
+	{
+		// Last task, race the thieves for it
+		bool won = top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+// Take the oldest task, called by any other thread
+bool taskDeque::steal(task& t)
+{
+	int64_t tp = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (tp >= b)
+		return false;
+
+	slots[tp & (capacity - 1)].load(t);
+	return top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+taskScheduler::taskScheduler(int nThreadCount)
+: taskScheduler(schedulerSettings(nThreadCount))
+{}
+
+taskScheduler::taskScheduler(const schedulerSettings& nSettings)
+:settings(nSettings), id(nextSchedulerId++), external(std::make_shared<externalSlotTable>()), warnedInline(false), stopping(false), epoch(0), sleepers(0), currentRegion(nullptr), regionEpoch(0)
+{
+	// One worker per available core, the thread waiting for the tasks runs them on the remaining core
+	if (settings.threadCount <= 0)
+		settings.threadCount = int(getAvailableCores().size()) - 1;
+
+	threadCount = settings.threadCount;
+	slotCount = threadCount + externalSlots;
+	deques = new taskDeque[slotCount];
+	owner = std::this_thread::get_id();
+
+	workers.reserve(threadCount);
+	for (int i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back([this, i]() { workerLoop(i); });
+	}
+	placeThreads();
+
+	log::info("taskScheduler::taskScheduler - Started {} workers, pinning {}, main core reserved {}", threadCount, settings.pinning, settings.reserveMainCore);
+}
+
+taskScheduler::~taskScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	sleepCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	delete[] deques;
+	external->closed.store(true, std::memory_order_relaxed);
+
+	// Hand the main thread its cores back, so that a following scheduler starts from the same affinity
+	if (settings.reserveMainCore && std::this_thread::get_id() == owner)
+		setCurrentAffinity(getAvailableCores());
+}
+
+const std::vector<int>& taskScheduler::getAvailableCores()
+{
+	static const std::vector<int> cores = []()
+	{
+		std::vector<int> available;
+#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) == 0)
+		{
+			for (int core = 0; core < CPU_SETSIZE; ++core)
+			{
+				if (CPU_ISSET(core, &set))
+					available.push_back(core);
+			}
+		}
+#elif defined(_WIN32)
+		DWORD_PTR processMask = 0;
+		DWORD_PTR systemMask = 0;
+		if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+		{
+			for (int core = 0; core < int(sizeof(DWORD_PTR) * 8); ++core)
+			{
+				if (processMask & (DWORD_PTR(1) << core))
+					available.push_back(core);
+			}
+		}
+#endif
+		if (available.empty())
+		{
+			for (int core = 0; core < int(std::max(1u, std::thread::hardware_concurrency())); ++core)
+			{
+				available.push_back(core);
+			}
+		}
+		return available;
+	}();
+	return cores;
+}
+
+bool taskScheduler::setThreadAffinity(std::thread& thread, const std::vector<int>& cores)
+{
+	return setAffinity(thread.native_handle(), cores);
+}
+
+// Apply the pinning and main core settings to the workers and the constructing thread
+// Settings that can't be applied on this host are logged and switched off
+void taskScheduler::placeThreads()
+{
+	const std::vector<int>& cores = getAvailableCores();
+	workerCores = cores;
+	if (!settings.pinning && !settings.reserveMainCore)
+		return;
+
+	if (settings.reserveMainCore)
+	{
+		if (cores.size() < 2 || !setCurrentAffinity({cores[0]}))
+		{
+			log::error("taskScheduler::placeThreads - Can't reserve a core for the main thread with {} available cores", cores.size());
+			settings.reserveMainCore = false;
+		}
+		else
+		{
+			workerCores.erase(workerCores.begin());
+		}
+	}
+
+	for (int i = 0; i < threadCount; ++i)
+	{
+		bool placed = settings.pinning ?
+			setAffinity(workers[i].native_handle(), {workerCores[i % workerCores.size()]}) :
+			setAffinity(workers[i].native_handle(), workerCores);
+		if (!placed)
+		{
+			log::error("taskScheduler::placeThreads - Failed to set the affinity of worker {}", i);
+			settings.pinning = false;
+			return;
+		}
+	}
+}
+
+const std::vector<int>& taskScheduler::getWorkerCores()
+{
+	return workerCores;
+}
+
+int taskScheduler::getThreadCount()
+{
+	return threadCount;
+}
+
+const schedulerSettings& taskScheduler::getSettings()
+{
+	return settings;
+}
+
+// Get the deque of the calling thread, handing out an external one on its first call
+// Returns -1 once every external deque is taken
+int taskScheduler::getSlot()
+{
+	if (currentScheduler == id)
+		return currentSlot;
+
+	std::vector<externalClaim>& claims = currentClaims.claims;
+	for (const externalClaim& claim : claims)
+	{
+		if (claim.scheduler == id)
+			return threadCount + claim.index;
+	}
+
+	// Forget the deques of destroyed schedulers, then take a free deque of this one
+	claims.erase(std::remove_if(claims.begin(), claims.end(), [](const externalClaim& claim) { return claim.table->closed.load(std::memory_order_relaxed); }), claims.end());
+	for (int index = 0; index < externalSlots; ++index)
+	{
+		bool expected = false;
+		if (!external->taken[index].load(std::memory_order_relaxed) && external->taken[index].compare_exchange_strong(expected, true, std::memory_order_acquire))
+		{
+			claims.push_back({id, index, external});
+			return threadCount + index;
+		}
+	}
+
+	// Tried again on the next submit, a deque may have been given back by then
+	if (!warnedInline.exchange(true, std::memory_order_relaxed))
+		log::error("taskScheduler::getSlot - All {} external deques are held by other threads, tasks of this thread run inline", externalSlots);
+	return -1;
+}
+
+void taskScheduler::push(const task& t)
+{
+	t.group->pending.fetch_add(1, std::memory_order_relaxed);
+
+	int slot = getSlot();
+	if (slot < 0 || !deques[slot].push(t))
+	{
+		task inlineTask = t;
+		execute(inlineTask);
+		return;
+	}
+
+	// Wake a sleeping worker, the epoch keeps it from missing tasks pushed while it was going to sleep
+	epoch.fetch_add(1);
+	if (sleepers.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		sleepCondition.notify_one();
+	}
+}
+
+// Pop from the own deque, then try to steal from every other deque starting at a random one
+bool taskScheduler::findTask(int slot, task& t)
+{
+	if (slot >= 0 && deques[slot].pop(t))
+		return true;
+
+	stealSeed ^= stealSeed << 13;
+	stealSeed ^= stealSeed >> 17;
+	stealSeed ^= stealSeed << 5;
+
+	int start = int(stealSeed % uint32_t(slotCount));
+	for (int k = 0; k < slotCount; ++k)
+	{
+		int victim = (start + k) % slotCount;
+		if (victim != slot && deques[victim].steal(t))
+			return true;
+	}
+	return false;
+}
+
+void taskScheduler::execute(task& t)
+{
+	t.run(t.context, t.begin, t.end);
+	t.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void taskScheduler::wait(taskGroup& group)
+{
+	int slot = getSlot();
+	int idleRounds = 0;
+	task t;
+	while (group.pending.load(std::memory_order_acquire) > 0)
+	{
+		if (findTask(slot, t))
+		{
+			execute(t);
+			idleRounds = 0;
+			continue;
+		}
+
+		// The remaining tasks are running on other threads
+		idleRounds++;
+		if (idleRounds < spinRounds)
+			CPU_RELAX();
+		else
+			std::this_thread::yield();
+	}
+}
+
+// Publish a phased region and wake every sleeping worker for it
+void taskScheduler::startRegion(phaseRegion& region)
+{
+	currentRegion.store(&region, std::memory_order_relaxed);
+	regionEpoch.fetch_add(1);
+
+	epoch.fetch_add(1);
+	if (sleepers.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		sleepCondition.notify_all();
+	}
+}
+
+void taskScheduler::runRegion(int slot)
+{
+	phaseRegion* region = currentRegion.load(std::memory_order_relaxed);
+	phaseContext phase(slot + 1, threadCount + 1, region->barrier);
+	region->run(region->context, phase);
+	region->remaining.fetch_sub(1, std::memory_order_release);
+}
+
+// Wait for the workers to leave the region, they are past its last phase already
+void taskScheduler::finishRegion(phaseRegion& region)
+{
+	int idleRounds = 0;
+	while (region.remaining.load(std::memory_order_acquire) > 0)
+	{
+		idleRounds++;
+		if (idleRounds < spinRounds)
+			CPU_RELAX();
+		else
+			std::this_thread::yield();
+	}
+}
+
+// Run tasks until the scheduler stops, spinning briefly before yielding and finally sleeping when idle
+// A new phased region takes precedence over queued tasks, as the other threads of the region wait for this one
+void taskScheduler::workerLoop(int slot)
+{
+	currentScheduler = id;
+	currentSlot = slot;
+	tracer::setThreadName("worker " + std::to_string(slot));
+
+	uint64_t seenRegion = 0;
+	int idleRounds = 0;
+	task t;
+	while (!stopping.load(std::memory_order_relaxed))
+	{
+		uint64_t latestRegion = regionEpoch.load();
+		if (latestRegion != seenRegion)
+		{
+			seenRegion = latestRegion;
+			runRegion(slot);
+			idleRounds = 0;
+			continue;
+		}
+
+		if (findTask(slot, t))
+		{
+			execute(t);
+			idleRounds = 0;
+			continue;
+		}
+
+		idleRounds++;
+		if (idleRounds < spinRounds)
+		{
+			CPU_RELAX();
+			continue;
+		}
+		if (idleRounds < spinRounds + yieldRounds)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Look once more after reading the epoch, a submit or region after this point wakes the worker up
+		uint64_t seen = epoch.load();
+		if (regionEpoch.load() != seenRegion)
+			continue;
+		if (findTask(slot, t))
+		{
+			execute(t);
+			idleRounds = 0;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepers++;
+		sleepCondition.wait(lock, [&]() { return stopping.load() || epoch.load() != seen; });
+		sleepers--;
+		idleRounds = 0;
+	}
+}
@@ -0,0 +1,145 @@
+#include "terminalView.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+
+#include "phaseTimers.hpp"
+#include "taskScheduler.hpp"
+#include "trace.hpp"
+
+#if defined(_WIN32)
+#include <io.h>
+#define isatty _isatty
+#define fileno _fileno
+#else
+#include <unistd.h>
+#endif
+
+terminalView::terminalView(double nInterval)
+{
+	// Refresh
+	interval = nInterval;
+	isTerminal = isatty(fileno(stdout)) != 0;
+
+	// Thread
+	stopping = false;
+
+	// Log
+	revision = 0;
+}
+
+void terminalView::start(const std::vector<int>& cores)
+{
+	if (isTerminal)
+	{
+		// Clear the screen and keep the log scrolling below the status region
+		fmt::print("\033[2J\033[{};r\033[999;1H", statusHeight + 1);
+		fflush(stdout);
+	}
+
+	stopping = false;
+	thread = std::thread([this]() { loop(); });
+	if (!cores.empty() && !taskScheduler::setThreadAffinity(thread, cores))
+		log::error("terminalView::start - Failed to set the affinity of the view thread");
+}
+
+void terminalView::stop()
+{
+	if (!thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(viewMutex);
+		stopping = true;
+	}
+	viewCondition.notify_one();
+	thread.join();
+
+	if (isTerminal)
+	{
+		// Give the whole terminal back to the shell
+		fmt::print("\033[r\033[999;1H\n");
+		fflush(stdout);
+	}
+}
+
+void terminalView::setStatus(const std::vector<std::string>& lines)
+{
+	std::lock_guard<std::mutex> lock(viewMutex);
+	status = lines;
+}
+
+void terminalView::loop()
+{
+	tracer::setThreadName("terminal");
+	auto wait = std::chrono::duration<double>(interval);
+
+	std::unique_lock<std::mutex> lock(viewMutex);
+	while (!stopping)
+	{
+		viewCondition.wait_for(lock, wait, [this]() { return stopping; });
+		statusCopy = status;
+
+		lock.unlock();
+		refresh();
+		lock.lock();
+	}
+}
+
+// Print the new and changed log entries, then redraw the status region, all with a single write
+void terminalView::refresh()
+{
+	TRACE_SCOPE("terminal");
+	revision = log::getChanges(revision, changes);
+
+	std::string buffer;
+	for (const auto& entry : changes)
+	{
+		const char* color = isTerminal ? ((entry.level == LogLevel::Error) ? "\033[31m" : "\033[32m") : "";
+		const char* reset = isTerminal ? "\033[0m" : "";
+		if (entry.level == LogLevel::Error)
+		{
+			fmt::format_to(std::back_inserter(buffer),
+				"{}[ERROR]{} [{}] {} [{}]\n", color, reset, entry.timestamp, entry.message, entry.calls);
+		}
+		else
+		{
+			fmt::format_to(std::back_inserter(buffer),
+				"{}[INFO]{} [{}] {}\n", color, reset, entry.timestamp, entry.message);
+		}
+	}
+
+	if (isTerminal)
+		appendStatus(buffer);
+
+	if (buffer.empty())
+		return;
+
+	fwrite(buffer.data(), 1, buffer.size(), stdout);
+	fflush(stdout);
+}
+
+// Redraw the status region in place, and put the cursor back where the log continues
+void terminalView::appendStatus(std::string& buffer)
+{
+	std::string lines[statusHeight];
+	for (const auto& line : statusCopy)
+	{
+		lines[0] += (lines[0].empty() ? "" : "  ") + line;
+	}
+	for (int phase = 0; phase < int(timedPhase::count); ++phase)
+	{
+		std::string& line = lines[(phase < int(timedPhase::events)) ? 1 : 2];
+		line += (line.empty() ? "" : "  ") + phaseTimers::getSummary(timedPhase(phase));
+	}
+	lines[3] = phaseTimers::getThreadSummary();
+	lines[4] = std::string(40, '-');
+
+	buffer.append("\0337");
+	for (int l = 0; l < statusHeight; ++l)
+	{
+		fmt::format_to(std::back_inserter(buffer), "\033[{};1H\033[2K{}", l + 1, lines[l]);
+	}
+	buffer.append("\0338");
+}
@@ -0,0 +1,161 @@
+#include "trace.hpp"
+
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <fmt/format.h>
+
+#include "log.hpp"
+
+std::atomic<bool> tracer::running(false);
+std::atomic<int64_t> tracer::sessionStart(0);
+std::array<std::atomic<traceBuffer*>, tracer::maxThreads> tracer::buffers{};
+std::atomic<int> tracer::bufferCount(0);
+
+// Steady clock time every timestamp is relative to
+static const std::chrono::steady_clock::time_point traceEpoch = std::chrono::steady_clock::now();
+
+// Only their own threads write to the rings, so instead of clearing them a new session moves the time from which dump keeps events
+void tracer::start()
+{
+	sessionStart.store(now(), std::memory_order_relaxed);
+	running.store(true, std::memory_order_relaxed);
+	log::info("tracer::start - Recording up to {} events per thread", traceBuffer::capacity);
+}
+
+void tracer::stop()
+{
+	running.store(false, std::memory_order_relaxed);
+}
+
+bool tracer::isRunning()
+{
+	return running.load(std::memory_order_relaxed);
+}
+
+int64_t tracer::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+static thread_local std::string pendingThreadName;
+
+// Ring of the calling thread, created on its first event
+// Buffers live until the process exits, so a dump never races with a thread that finished
+traceBuffer* tracer::getBuffer()
+{
+	thread_local traceBuffer* buffer = nullptr;
+	thread_local bool full = false;
+	if (buffer != nullptr || full)
+		return buffer;
+
+	int index = bufferCount.fetch_add(1, std::memory_order_relaxed);
+	if (index >= maxThreads)
+	{
+		full = true;
+		return nullptr;
+	}
+
+	buffer = new traceBuffer();
+	std::string name = pendingThreadName.empty() ? fmt::format("thread {}", index) : pendingThreadName;
+	size_t length = std::min(name.size(), sizeof(buffer->threadName) - 1);
+	std::memcpy(buffer->threadName, name.data(), length);
+	buffer->threadName[length] = '\0';
+	buffers[index].store(buffer, std::memory_order_release);
+	return buffer;
+}
+
+void tracer::setThreadName(const std::string& name)
+{
+	pendingThreadName = name;
+}
+
+void tracer::record(const char* name, const char* argName, int64_t arg, int64_t start, int64_t duration)
+{
+	traceBuffer* buffer = getBuffer();
+	if (buffer == nullptr)
+		return;
+
+	// Claim the slot before touching it, a dump that sees any of the new fields also sees the claim
+	int64_t index = buffer->written.load(std::memory_order_relaxed);
+	buffer->claimed.store(index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	traceEvent& event = buffer->events[index % traceBuffer::capacity];
+	event.name.store(name, std::memory_order_relaxed);
+	event.argName.store(argName, std::memory_order_relaxed);
+	event.arg.store(arg, std::memory_order_relaxed);
+	event.start.store(start, std::memory_order_relaxed);
+	event.duration.store(duration, std::memory_order_relaxed);
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+// Plain copy of an event taken by a dump
+struct tracedEvent
+{
+	const char* name;
+	const char* argName;
+	int64_t arg;
+	int64_t start;
+	int64_t duration;
+};
+
+int tracer::dump(const std::string& filePath)
+{
+	FILE* file = fopen(filePath.c_str(), "w");
+	if (file == nullptr)
+	{
+		log::error("tracer::dump - Could not open file {}", filePath);
+		return 0;
+	}
+
+	fmt::print(file, "{{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	int total = 0;
+	bool first = true;
+	std::vector<tracedEvent> copies;
+	int count = std::min(bufferCount.load(std::memory_order_relaxed), maxThreads);
+	int64_t session = sessionStart.load(std::memory_order_relaxed);
+	for (int t = 0; t < count; ++t)
+	{
+		traceBuffer* buffer = buffers[t].load(std::memory_order_acquire);
+		if (buffer == nullptr)
+			continue;
+
+		fmt::print(file, "{}{{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": {}, \"args\": {{\"name\": \"{}\"}}}}",
+			first ? "" : ",\n", t, buffer->threadName);
+		first = false;
+
+		// Copy the ring, then drop the oldest events if the owner wrapped around onto them meanwhile
+		int64_t end = buffer->written.load(std::memory_order_acquire);
+		int64_t begin = std::max<int64_t>(0, end - traceBuffer::capacity);
+		copies.resize(end - begin);
+		for (int64_t i = begin; i < end; ++i)
+		{
+			traceEvent& event = buffer->events[i % traceBuffer::capacity];
+			copies[i - begin] = {event.name.load(std::memory_order_relaxed), event.argName.load(std::memory_order_relaxed),
+				event.arg.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed), event.duration.load(std::memory_order_relaxed)};
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		int64_t overwritten = buffer->claimed.load(std::memory_order_relaxed) - traceBuffer::capacity;
+
+		for (int64_t i = std::max(begin, overwritten); i < end; ++i)
+		{
+			const tracedEvent& event = copies[i - begin];
+			if (event.name == nullptr || event.start < session)
+				continue;
+
+			fmt::print(file, ",\n{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}",
+				event.name, t, event.start * 1e-3, event.duration * 1e-3);
+			if (event.argName != nullptr)
+				fmt::print(file, ", \"args\": {{\"{}\": {}}}", event.argName, event.arg);
+			fmt::print(file, "}}");
+			total++;
+		}
+	}
+	fmt::print(file, "\n]}}\n");
+	fclose(file);
+
+	log::info("tracer::dump - Wrote {} events of {} threads to {}", total, count, filePath);
+	return total;
+}